@@ -0,0 +1,411 @@
+#include <artemis/World.h>
+#include <artemis/Entity.h>
+#include <artemis/Component.h>
+#include <artemis/systems/EntityProcessingSystem.h>
+#include <artemis/managers/GroupManager.h>
+#include <artemis/managers/TagManager.h>
+#include <artemis/Aspect.h>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+ * Microbenchmarks of the core operations, swept over entity counts by powers of ten.
+ * Every result is printed as one JSON object per line:
+ *
+ *   {"benchmark":"iterate","params":"mappers=2","entities":1000,"ops":...,"seconds":...,"ns_per_op":...}
+ *
+ * Usage: benchmark [--min N] [--max N] [--time SECONDS] [--filter NAME]
+ *   --min, --max   smallest and largest entity count (default 1000 and 100000; removing
+ *                  an entity from a system searches its actives, so churn and toggle
+ *                  grow quadratically, and 10000000 needs a few GB of memory)
+ *   --time         minimum measured time per result (default 0.2)
+ *   --filter       only run benchmarks whose name contains NAME
+ */
+
+enum ComponentTypes {
+   ctA = 0,
+   ctB,
+   ctC,
+   ctD,
+   ctE,
+};
+
+class AComponent : public artemis::Component
+{
+public:
+   float x;
+   AComponent(): Component(ctA), x(1.f) {}
+};
+
+class BComponent : public artemis::Component
+{
+public:
+   float x;
+   BComponent(): Component(ctB), x(1.f) {}
+};
+
+class CComponent : public artemis::Component
+{
+public:
+   float x;
+   CComponent(): Component(ctC), x(1.f) {}
+};
+
+class DComponent : public artemis::Component
+{
+public:
+   float x;
+   DComponent(): Component(ctD), x(1.f) {}
+};
+
+class EComponent : public artemis::Component
+{
+public:
+   float x;
+   EComponent(): Component(ctE), x(1.f) {}
+};
+
+/**
+ * Reads one to four components of every entity and writes the first one.
+ */
+class IterateSystem : public artemis::EntityProcessingSystem
+{
+private:
+   artemis::ComponentMapper<AComponent, ctA> aMapper;
+   artemis::ComponentMapper<BComponent, ctB> bMapper;
+   artemis::ComponentMapper<CComponent, ctC> cMapper;
+   artemis::ComponentMapper<DComponent, ctD> dMapper;
+   int mMappers;
+
+   static artemis::Aspect * aspectFor(int mappers)
+   {
+      switch (mappers) {
+      case 1: return artemis::Aspect::getAspectForAll(ctA);
+      case 2: return artemis::Aspect::getAspectForAll(ctA, ctB);
+      case 3: return artemis::Aspect::getAspectForAll(ctA, ctB, ctC);
+      default: return artemis::Aspect::getAspectForAll(ctA, ctB, ctC, ctD);
+      }
+   }
+
+public:
+   IterateSystem(int mappers): EntityProcessingSystem(aspectFor(mappers), 0), mMappers(mappers)
+   {
+      registerMapper(&aMapper);
+      registerMapper(&bMapper);
+      registerMapper(&cMapper);
+      registerMapper(&dMapper);
+   }
+
+   virtual void process(artemis::Entity *e) override
+   {
+      AComponent *a = aMapper.get(e);
+      switch (mMappers) {
+      case 1: a->x += 1.f; break;
+      case 2: a->x += bMapper.get(e)->x; break;
+      case 3: a->x += bMapper.get(e)->x * cMapper.get(e)->x; break;
+      default: a->x += bMapper.get(e)->x * cMapper.get(e)->x + dMapper.get(e)->x; break;
+      }
+   }
+};
+
+/**
+ * Passive system holding mappers, used to call ComponentMapper::get and getSafe directly.
+ */
+class MapperSystem : public artemis::EntityProcessingSystem
+{
+public:
+   artemis::ComponentMapper<AComponent, ctA> aMapper;
+
+   MapperSystem(): EntityProcessingSystem(artemis::Aspect::getAspectForAll(ctA), 0)
+   {
+      registerMapper(&aMapper);
+   }
+
+   virtual void process(artemis::Entity *e) override {}
+};
+
+/**
+ * Passive system with an aspect derived from its type, for measuring World::check().
+ */
+class CheckSystem : public artemis::EntityProcessingSystem
+{
+   static artemis::Aspect * aspectFor(artemis::EntitySystemType tp)
+   {
+      artemis::Aspect *aspect = artemis::Aspect::getAspectForAll(static_cast<artemis::ComponentType>(tp % 4));
+      if (tp % 3 == 1)
+         aspect->exclude(1, static_cast<artemis::ComponentType>(ctE));
+      return aspect;
+   }
+
+public:
+   CheckSystem(artemis::EntitySystemType tp): EntityProcessingSystem(aspectFor(tp), tp) {}
+
+   virtual void process(artemis::Entity *e) override {}
+};
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+size_t minEntities = 1000;
+size_t maxEntities = 100000;
+double minTime = 0.2;
+const char *filter = nullptr;
+float sink = 0.f;
+
+double seconds(Clock::time_point start)
+{
+   return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+void report(const char *name, const std::string &params, size_t entities, size_t ops, double time)
+{
+   std::cout << "{\"benchmark\":\"" << name << "\",\"params\":\"" << params << "\",\"entities\":" << entities
+             << ",\"ops\":" << ops << ",\"seconds\":" << time
+             << ",\"ns_per_op\":" << (ops > 0 ? time * 1e9 / ops : 0.0) << '}' << std::endl;
+}
+
+bool enabled(const char *name)
+{
+   return filter == nullptr || std::strstr(name, filter) != nullptr;
+}
+
+/*
+ * Runs round() until minTime has passed, round() returns the operations it made.
+ */
+void measure(const char *name, const std::string &params, size_t entities, const std::function<size_t()> &round)
+{
+   size_t ops = 0;
+   Clock::time_point start = Clock::now();
+   double time = 0.0;
+   do {
+      ops += round();
+      time = seconds(start);
+   } while (time < minTime);
+   report(name, params, entities, ops, time);
+}
+
+std::vector<artemis::Entity *> populate(artemis::World &world, size_t n, int components)
+{
+   std::vector<artemis::Entity *> entities;
+   entities.reserve(n);
+   for (size_t i = 0; i < n; ++i) {
+      artemis::Entity *e = world.createEntity();
+      if (components > 0) e->addComponent(new AComponent());
+      if (components > 1) e->addComponent(new BComponent());
+      if (components > 2) e->addComponent(new CComponent());
+      if (components > 3) e->addComponent(new DComponent());
+      e->addToWorld();
+      entities.push_back(e);
+   }
+   world.process();
+   return entities;
+}
+
+void benchChurn(size_t n)
+{
+   artemis::World world;
+   world.setSystem(new IterateSystem(2));
+   world.initialize();
+
+   std::vector<artemis::Entity *> entities(n);
+   measure("churn", "create+add+delete", n, [&]() {
+      for (size_t i = 0; i < n; ++i) {
+         artemis::Entity *e = world.createEntity();
+         e->addComponent(new AComponent());
+         e->addComponent(new BComponent());
+         e->addToWorld();
+         entities[i] = e;
+      }
+      world.process();
+      for (size_t i = 0; i < n; ++i) {
+         entities[i]->deleteFromWorld();
+      }
+      world.process();
+      return n;
+   });
+}
+
+void benchComponentToggle(size_t n)
+{
+   artemis::World world;
+   world.setSystem(new IterateSystem(2));
+   world.initialize();
+   std::vector<artemis::Entity *> entities = populate(world, n, 1);
+
+   measure("toggle", "addComponent/removeComponent+changedInWorld", n, [&]() {
+      for (size_t i = 0; i < n; ++i) {
+         entities[i]->addComponent(new BComponent());
+         entities[i]->changedInWorld();
+      }
+      world.process();
+      for (size_t i = 0; i < n; ++i) {
+         entities[i]->removeComponent(ctB);
+         entities[i]->changedInWorld();
+      }
+      world.process();
+      return 2 * n;
+   });
+}
+
+void benchIterate(size_t n)
+{
+   for (int mappers = 1; mappers <= 4; ++mappers) {
+      artemis::World world;
+      world.setSystem(new IterateSystem(mappers));
+      world.initialize();
+      populate(world, n, 4);
+
+      measure("iterate", "mappers=" + std::to_string(mappers), n, [&]() {
+         world.process();
+         return n;
+      });
+   }
+}
+
+void benchMapper(size_t n)
+{
+   artemis::World world;
+   MapperSystem *system = world.setSystem(new MapperSystem(), true);
+   world.initialize();
+   std::vector<artemis::Entity *> entities = populate(world, n, 1);
+
+   measure("mapper", "get", n, [&]() {
+      float sum = 0.f;
+      for (size_t i = 0; i < n; ++i) {
+         sum += system->aMapper.get(entities[i])->x;
+      }
+      sink += sum;
+      return n;
+   });
+   measure("mapper", "getSafe", n, [&]() {
+      float sum = 0.f;
+      for (size_t i = 0; i < n; ++i) {
+         sum += system->aMapper.getSafe(entities[i])->x;
+      }
+      sink += sum;
+      return n;
+   });
+}
+
+void benchCheck(size_t n)
+{
+   const size_t counts[] = { 10, 16, 32, 64 };
+   for (size_t c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c) {
+      artemis::World world;
+      for (artemis::EntitySystemType tp = 0; tp < counts[c]; ++tp) {
+         world.setSystem(new CheckSystem(tp), true);
+      }
+      world.initialize();
+      std::vector<artemis::Entity *> entities = populate(world, n, 4);
+
+      measure("check", "systems=" + std::to_string(counts[c]), n, [&]() {
+         for (size_t i = 0; i < n; ++i) {
+            entities[i]->changedInWorld();
+         }
+         world.process();
+         return n;
+      });
+   }
+}
+
+void benchGroupManager(size_t n)
+{
+   artemis::World world;
+   artemis::GroupManager<int> *groups = world.setManager(new artemis::GroupManager<int>());
+   world.initialize();
+   std::vector<artemis::Entity *> entities = populate(world, n, 1);
+
+   measure("group_manager", "add+isInGroup+removeFromAllGroups", n, [&]() {
+      for (size_t i = 0; i < n; ++i) {
+         groups->add(entities[i], static_cast<int>(i % 16));
+      }
+      size_t found = 0;
+      for (size_t i = 0; i < n; ++i) {
+         found += groups->isInGroup(entities[i], static_cast<int>(i % 16)) ? 1 : 0;
+      }
+      for (size_t i = 0; i < n; ++i) {
+         groups->removeFromAllGroups(entities[i]);
+      }
+      sink += found;
+      return 3 * n;
+   });
+}
+
+void benchTagManager(size_t n)
+{
+   artemis::World world;
+   artemis::TagManager<size_t> *tags = world.setManager(new artemis::TagManager<size_t>());
+   world.initialize();
+   std::vector<artemis::Entity *> entities = populate(world, n, 1);
+
+   measure("tag_manager", "registerTag+getEntity+unregister", n, [&]() {
+      for (size_t i = 0; i < n; ++i) {
+         tags->registerTag(i, entities[i]);
+      }
+      size_t found = 0;
+      for (size_t i = 0; i < n; ++i) {
+         found += tags->getEntity(i) == entities[i] ? 1 : 0;
+      }
+      for (size_t i = 0; i < n; ++i) {
+         tags->unregister(i);
+      }
+      sink += found;
+      return 3 * n;
+   });
+}
+
+}
+
+int main(int argc, char **argv)
+{
+   for (int i = 1; i + 1 < argc; i += 2) {
+      if (std::strcmp(argv[i], "--min") == 0) {
+         minEntities = std::strtoull(argv[i + 1], nullptr, 10);
+      }
+      else if (std::strcmp(argv[i], "--max") == 0) {
+         maxEntities = std::strtoull(argv[i + 1], nullptr, 10);
+      }
+      else if (std::strcmp(argv[i], "--time") == 0) {
+         minTime = std::atof(argv[i + 1]);
+      }
+      else if (std::strcmp(argv[i], "--filter") == 0) {
+         filter = argv[i + 1];
+      }
+      else {
+         std::cerr << "unknown option " << argv[i] << std::endl;
+         return 1;
+      }
+   }
+
+   struct Benchmark
+   {
+      const char *name;
+      void (*run)(size_t);
+   };
+   const Benchmark benchmarks[] = {
+      { "churn", benchChurn },
+      { "toggle", benchComponentToggle },
+      { "iterate", benchIterate },
+      { "mapper", benchMapper },
+      { "check", benchCheck },
+      { "group_manager", benchGroupManager },
+      { "tag_manager", benchTagManager },
+   };
+
+   for (size_t n = minEntities; n <= maxEntities; n *= 10) {
+      for (size_t b = 0; b < sizeof(benchmarks) / sizeof(benchmarks[0]); ++b) {
+         if (enabled(benchmarks[b].name)) {
+            benchmarks[b].run(n);
+         }
+      }
+   }
+
+   return sink == 42.f ? 1 : 0;
+}
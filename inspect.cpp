@@ -0,0 +1,75 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+/*
+ * Client for a world inspector, see artemis::WorldInspector.
+ *
+ * Usage: inspect SOCKET [COMMAND...]
+ *   Sends each command (counts, systems, memory, churn, all) and prints the answers.
+ *   Without commands, reads them from standard input, one per line.
+ */
+
+namespace
+{
+
+bool ask(int fd, const std::string &command, std::string &pending)
+{
+   std::string line = command + "\n";
+   if (write(fd, line.data(), line.size()) != static_cast<ssize_t>(line.size()))
+      return false;
+
+   size_t end;
+   char buffer[4096];
+   while ((end = pending.find('\n')) == std::string::npos) {
+      ssize_t n = read(fd, buffer, sizeof(buffer));
+      if (n <= 0)
+         return false;
+      pending.append(buffer, n);
+   }
+   std::cout << pending.substr(0, end) << std::endl;
+   pending.erase(0, end + 1);
+   return true;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+   if (argc < 2) {
+      std::cerr << "usage: " << argv[0] << " SOCKET [counts|systems|memory|churn|all]..." << std::endl;
+      return 1;
+   }
+
+   sockaddr_un address;
+   std::memset(&address, 0, sizeof(address));
+   address.sun_family = AF_UNIX;
+   std::strncpy(address.sun_path, argv[1], sizeof(address.sun_path) - 1);
+
+   int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (fd < 0 || connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0) {
+      std::cerr << "cannot connect to " << argv[1] << std::endl;
+      return 1;
+   }
+
+   std::string pending;
+   bool ok = true;
+   if (argc > 2) {
+      for (int i = 2; i < argc && ok; ++i) {
+         ok = ask(fd, argv[i], pending);
+      }
+   }
+   else {
+      std::string command;
+      while (ok && std::getline(std::cin, command)) {
+         if (!command.empty())
+            ok = ask(fd, command, pending);
+      }
+   }
+
+   close(fd);
+   return ok ? 0 : 1;
+}
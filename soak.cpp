@@ -0,0 +1,452 @@
+#include <artemis/World.h>
+#include <artemis/Entity.h>
+#include <artemis/Component.h>
+#include <artemis/EntityManager.h>
+#include <artemis/systems/EntityProcessingSystem.h>
+#include <artemis/Aspect.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+/*
+ * Soak test: drives a world through production-like churn for a long time and
+ * reports how frame times, memory and fragmentation evolve. Every report interval
+ * one JSON object per line is printed with the frame-time percentiles of the
+ * interval, RSS, heap fragmentation and the world's memory and id pool; the last
+ * line holds the percentiles of the whole run.
+ *
+ * A frame's time covers issuing that frame's spawns, despawns and component
+ * changes plus World.process().
+ *
+ * Usage: soak [--pattern waves|trickle|unload|toggle|mixed] [--seconds N] [--frames N]
+ *             [--entities N] [--rate N] [--report SECONDS] [--clean-budget N] [--seed N]
+ *   --pattern       churn to replay (default mixed)
+ *                     waves    a wave of --entities spawns every 120 frames and lives 300 frames
+ *                     trickle  --rate spawns per frame with exponential lifetimes averaging 600 frames
+ *                     unload   a level of --entities loads, lives 600 frames and is deleted at once
+ *                     toggle   --rate entities a frame get a component added or removed
+ *                     mixed    trickle, toggle and an unload every 3000 frames over a resident level
+ *   --seconds       how long to run (default 3600)
+ *   --frames        stop after this many frames (default unlimited)
+ *   --entities      size of waves and levels (default 20000)
+ *   --rate          spawns or toggles per frame (default 100)
+ *   --report        seconds between reports (default 10)
+ *   --clean-budget  see World.setCleanBudget() (default 0)
+ *   --seed          random seed (default 1)
+ */
+
+enum ComponentTypes {
+   ctPosition = 0,
+   ctVelocity,
+   ctHealth,
+   ctFrozen,
+};
+
+enum EntitySystemTypes {
+   estMove = 0,
+   estHealth,
+};
+
+class PositionComponent : public artemis::Component
+{
+public:
+   float x, y;
+   PositionComponent(): Component(ctPosition), x(0.f), y(0.f) {}
+};
+
+class VelocityComponent : public artemis::Component
+{
+public:
+   float x, y;
+   VelocityComponent(float vx, float vy): Component(ctVelocity), x(vx), y(vy) {}
+};
+
+class HealthComponent : public artemis::Component
+{
+public:
+   float hp;
+   HealthComponent(): Component(ctHealth), hp(100.f) {}
+};
+
+class FrozenComponent : public artemis::Component
+{
+public:
+   FrozenComponent(): Component(ctFrozen) {}
+};
+
+class MoveSystem : public artemis::EntityProcessingSystem
+{
+private:
+   artemis::ComponentMapper<PositionComponent, ctPosition> posMapper;
+   artemis::ComponentMapper<VelocityComponent, ctVelocity> velMapper;
+public:
+   MoveSystem(): EntityProcessingSystem(artemis::Aspect::getAspectForAll(ctPosition, ctVelocity)->exclude(1, ctFrozen), estMove)
+   {
+      registerMapper(&posMapper);
+      registerMapper(&velMapper);
+   }
+   virtual void process(artemis::Entity *e) override
+   {
+      PositionComponent *p = posMapper.get(e);
+      VelocityComponent *v = velMapper.get(e);
+      p->x += v->x * getWorld()->getDelta();
+      p->y += v->y * getWorld()->getDelta();
+   }
+};
+
+class HealthSystem : public artemis::EntityProcessingSystem
+{
+private:
+   artemis::ComponentMapper<HealthComponent, ctHealth> healthMapper;
+public:
+   HealthSystem(): EntityProcessingSystem(artemis::Aspect::getAspectForAll(ctHealth), estHealth)
+   {
+      registerMapper(&healthMapper);
+   }
+   virtual void process(artemis::Entity *e) override
+   {
+      HealthComponent *h = healthMapper.get(e);
+      h->hp = h->hp < 100.f ? h->hp + getWorld()->getDelta() : 100.f;
+   }
+};
+
+namespace
+{
+
+typedef std::chrono::steady_clock Clock;
+
+/*
+ * Log-linear histogram of nanoseconds: 16 linear sub-buckets per power of two,
+ * values are reported as the upper bound of their bucket (within 6.25%).
+ */
+class Histogram
+{
+private:
+   static const int SUB_BUCKETS = 16;
+   static const int BUCKETS = 64 * SUB_BUCKETS;
+
+   uint64_t mCounts[BUCKETS];
+   uint64_t mTotal;
+   uint64_t mMax;
+
+   static int indexOf(uint64_t v)
+   {
+      if (v < SUB_BUCKETS)
+         return static_cast<int>(v);
+      int msb = 63 - __builtin_clzll(v);
+      int shift = msb - 4;
+      return (shift + 1) * SUB_BUCKETS + static_cast<int>((v >> shift) & (SUB_BUCKETS - 1));
+   }
+
+   static uint64_t upperBound(int index)
+   {
+      if (index < SUB_BUCKETS)
+         return index;
+      int shift = index / SUB_BUCKETS - 1;
+      uint64_t lower = static_cast<uint64_t>(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+      return lower + (uint64_t(1) << shift) - 1;
+   }
+
+public:
+   Histogram() { reset(); }
+
+   void reset()
+   {
+      std::memset(mCounts, 0, sizeof(mCounts));
+      mTotal = 0;
+      mMax = 0;
+   }
+
+   void record(uint64_t v)
+   {
+      mCounts[indexOf(v)]++;
+      mTotal++;
+      if (v > mMax)
+         mMax = v;
+   }
+
+   void merge(const Histogram &other)
+   {
+      for (int i = 0; i < BUCKETS; ++i) {
+         mCounts[i] += other.mCounts[i];
+      }
+      mTotal += other.mTotal;
+      if (other.mMax > mMax)
+         mMax = other.mMax;
+   }
+
+   uint64_t percentile(double p) const
+   {
+      uint64_t rank = static_cast<uint64_t>(p * mTotal);
+      uint64_t seen = 0;
+      for (int i = 0; i < BUCKETS; ++i) {
+         seen += mCounts[i];
+         if (seen > rank)
+            return upperBound(i) < mMax ? upperBound(i) : mMax;
+      }
+      return mMax;
+   }
+
+   uint64_t getTotal() const { return mTotal; }
+   uint64_t getMax() const { return mMax; }
+};
+
+struct Options
+{
+   std::string pattern;
+   double seconds;
+   uint64_t frames;
+   size_t entities;
+   size_t rate;
+   double reportInterval;
+   size_t cleanBudget;
+   unsigned int seed;
+};
+
+/*
+ * Entities the harness spawned, with the frame they are due to be deleted.
+ */
+struct Death
+{
+   uint64_t frame;
+   artemis::Entity *entity;
+   bool operator<(const Death &other) const { return frame > other.frame; }
+};
+
+class Soak
+{
+private:
+   const Options &mOptions;
+   artemis::World mWorld;
+   std::mt19937 mRandom;
+   std::priority_queue<Death> mDeaths;
+   std::vector<artemis::Entity *> mLevel;
+   uint64_t mFrame;
+
+   artemis::Entity * spawn(uint64_t lifetime)
+   {
+      std::uniform_real_distribution<float> speed(-1.f, 1.f);
+      artemis::Entity *e = mWorld.createEntity();
+      e->addComponent(new PositionComponent());
+      e->addComponent(new VelocityComponent(speed(mRandom), speed(mRandom)));
+      if (mRandom() % 2)
+         e->addComponent(new HealthComponent());
+      e->addToWorld();
+      if (lifetime > 0) {
+         Death death = { mFrame + lifetime, e };
+         mDeaths.push(death);
+      }
+      return e;
+   }
+
+   void despawnDue()
+   {
+      while (!mDeaths.empty() && mDeaths.top().frame <= mFrame) {
+         mDeaths.top().entity->deleteFromWorld();
+         mDeaths.pop();
+      }
+   }
+
+   void loadLevel()
+   {
+      for (size_t i = 0; i < mOptions.entities; ++i) {
+         mLevel.push_back(spawn(0));
+      }
+   }
+
+   void unloadLevel()
+   {
+      for (size_t i = 0; i < mLevel.size(); ++i) {
+         mLevel[i]->deleteFromWorld();
+      }
+      mLevel.clear();
+   }
+
+   void trickle()
+   {
+      std::exponential_distribution<double> lifetime(1.0 / 600.0);
+      for (size_t i = 0; i < mOptions.rate; ++i) {
+         spawn(1 + static_cast<uint64_t>(lifetime(mRandom)));
+      }
+   }
+
+   void toggle()
+   {
+      if (mLevel.empty())
+         return;
+      for (size_t i = 0; i < mOptions.rate; ++i) {
+         artemis::Entity *e = mLevel[mRandom() % mLevel.size()];
+         if (e->getComponent(ctFrozen) != nullptr)
+            e->removeComponent(ctFrozen);
+         else
+            e->addComponent(new FrozenComponent());
+         e->changedInWorld();
+      }
+   }
+
+public:
+   Soak(const Options &options): mOptions(options), mRandom(options.seed), mFrame(0)
+   {
+      mWorld.setSystem(new MoveSystem());
+      mWorld.setSystem(new HealthSystem());
+      mWorld.setCleanBudget(options.cleanBudget);
+      mWorld.initialize();
+   }
+
+   void step()
+   {
+      const std::string &pattern = mOptions.pattern;
+      despawnDue();
+
+      if (pattern == "waves") {
+         if (mFrame % 120 == 0) {
+            for (size_t i = 0; i < mOptions.entities; ++i) {
+               spawn(300);
+            }
+         }
+      }
+      else if (pattern == "trickle") {
+         trickle();
+      }
+      else if (pattern == "unload") {
+         if (mFrame % 600 == 0) {
+            unloadLevel();
+            loadLevel();
+         }
+      }
+      else if (pattern == "toggle") {
+         if (mFrame == 0)
+            loadLevel();
+         toggle();
+      }
+      else {
+         if (mFrame % 3000 == 0) {
+            unloadLevel();
+            loadLevel();
+         }
+         trickle();
+         toggle();
+      }
+
+      mWorld.setDelta(1.f / 60.f);
+      mWorld.process();
+      mFrame++;
+   }
+
+   artemis::World & getWorld() { return mWorld; }
+};
+
+size_t residentKilobytes()
+{
+#if defined(__linux__)
+   std::ifstream statm("/proc/self/statm");
+   size_t pages = 0, resident = 0;
+   if (statm >> pages >> resident)
+      return resident * (sysconf(_SC_PAGESIZE) / 1024);
+#endif
+   return 0;
+}
+
+void printReport(std::ostream &out, double elapsed, uint64_t frames, const Histogram &frameTimes, artemis::World &world, bool final)
+{
+   artemis::MemoryReport memory = world.memoryReport();
+   artemis::MemoryUsage total = memory.getTotal();
+
+   out << "{\"final\":" << (final ? "true" : "false")
+       << ",\"seconds\":" << elapsed
+       << ",\"frames\":" << frames
+       << ",\"entities\":" << world.getEntityManager()->getActiveEntityCount()
+       << ",\"p50_us\":" << frameTimes.percentile(0.5) / 1000.0
+       << ",\"p99_us\":" << frameTimes.percentile(0.99) / 1000.0
+       << ",\"p999_us\":" << frameTimes.percentile(0.999) / 1000.0
+       << ",\"max_us\":" << frameTimes.getMax() / 1000.0
+       << ",\"rss_kb\":" << residentKilobytes();
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+   // heap fragmentation: share of the heap held by malloc but not in use
+   struct mallinfo2 heap = mallinfo2();
+   size_t heapSize = heap.arena + heap.hblkhd;
+   size_t heapInUse = heap.uordblks + heap.hblkhd;
+   out << ",\"heap_bytes\":" << heapSize
+       << ",\"heap_in_use\":" << heapInUse
+       << ",\"heap_fragmentation\":" << (heapSize > 0 ? 1.0 - static_cast<double>(heapInUse) / heapSize : 0.0);
+#endif
+   // world slack: containers that grew for a peak and never shrink
+   out << ",\"world_used\":" << total.used
+       << ",\"world_reserved\":" << total.reserved
+       << ",\"world_slack\":" << (total.reserved > 0 ? 1.0 - static_cast<double>(total.used) / total.reserved : 0.0)
+       << ",\"free_ids\":" << memory.identifierPool.used / sizeof(unsigned int)
+       << ",\"entity_table\":" << memory.entities.reserved << '}' << std::endl;
+}
+
+}
+
+int main(int argc, char **argv)
+{
+   Options options;
+   options.pattern = "mixed";
+   options.seconds = 3600;
+   options.frames = 0;
+   options.entities = 20000;
+   options.rate = 100;
+   options.reportInterval = 10;
+   options.cleanBudget = 0;
+   options.seed = 1;
+
+   for (int i = 1; i + 1 < argc; i += 2) {
+      const char *value = argv[i + 1];
+      if (std::strcmp(argv[i], "--pattern") == 0) options.pattern = value;
+      else if (std::strcmp(argv[i], "--seconds") == 0) options.seconds = std::atof(value);
+      else if (std::strcmp(argv[i], "--frames") == 0) options.frames = std::strtoull(value, nullptr, 10);
+      else if (std::strcmp(argv[i], "--entities") == 0) options.entities = std::strtoull(value, nullptr, 10);
+      else if (std::strcmp(argv[i], "--rate") == 0) options.rate = std::strtoull(value, nullptr, 10);
+      else if (std::strcmp(argv[i], "--report") == 0) options.reportInterval = std::atof(value);
+      else if (std::strcmp(argv[i], "--clean-budget") == 0) options.cleanBudget = std::strtoull(value, nullptr, 10);
+      else if (std::strcmp(argv[i], "--seed") == 0) options.seed = static_cast<unsigned int>(std::strtoul(value, nullptr, 10));
+      else {
+         std::cerr << "unknown option " << argv[i] << std::endl;
+         return 1;
+      }
+   }
+
+   Soak soak(options);
+   Histogram interval, overall;
+   Clock::time_point start = Clock::now();
+   Clock::time_point lastReport = start;
+   uint64_t frames = 0;
+
+   for (;;) {
+      Clock::time_point frameStart = Clock::now();
+      soak.step();
+      Clock::time_point frameEnd = Clock::now();
+      interval.record(std::chrono::duration_cast<std::chrono::nanoseconds>(frameEnd - frameStart).count());
+      frames++;
+
+      double elapsed = std::chrono::duration<double>(frameEnd - start).count();
+      bool done = elapsed >= options.seconds || (options.frames > 0 && frames >= options.frames);
+      if (done || std::chrono::duration<double>(frameEnd - lastReport).count() >= options.reportInterval) {
+         printReport(std::cout, elapsed, frames, interval, soak.getWorld(), false);
+         overall.merge(interval);
+         interval.reset();
+         lastReport = frameEnd;
+      }
+      if (done) {
+         printReport(std::cout, elapsed, frames, overall, soak.getWorld(), true);
+         break;
+      }
+   }
+   return 0;
+}
@@ -25,6 +25,40 @@ Aspect * Aspect::all(ComponentType ct1, ComponentType ct2, ComponentType ct3)
 }
 */
 
+bool Aspect::matches(const std::bitset<64> &allSet, const std::bitset<64> &exclusionSet, const std::bitset<64> &oneSet, const std::bitset<64> &componentBits)
+{
+   if (allSet.none() && oneSet.none()) {
+      return false;
+   }
+
+   bool interested = true; // possibly interested, let's try to prove it wrong.
+
+   // Check if the entity possesses ALL of the components defined in the aspect.
+   if (!allSet.none()) {
+      if ((allSet & componentBits) != allSet) {
+         interested = false;
+      }
+      /*for (size_t i = 0; i < allSet.count(); ++i) {
+         if (allSet.test(i) && !componentBits.test(i)) {
+            interested = false;
+            break;
+         }
+      }*/
+   }
+
+   // Check if the entity possesses ANY of the exclusion components, if it does then the system is not interested.
+   if (!exclusionSet.none() && interested) {
+      interested = !((exclusionSet & componentBits).any());
+   }
+
+   // Check if the entity possesses ANY of the components in the oneSet. If so, the system is interested.
+   if (!oneSet.none()) {
+      interested = (oneSet & componentBits).any();
+   }
+
+   return interested;
+}
+
 Aspect * Aspect::exclude(size_t n, ...)
 {
    ComponentType val;
@@ -2,11 +2,27 @@
 #define Atemis_Aspect_h__
 
 #include <bitset>
+#include <cstdint>
 #include "artemis/ComponentType.h"
 
 namespace artemis
 {
 
+/**
+ * The bits of component types as a compile-time constant, e.g. for
+ * static constexpr aspect masks of systems, see Aspect.getAspectForMasks().
+ */
+inline constexpr uint64_t componentMask()
+{
+    return 0;
+}
+
+template<typename... Types>
+constexpr uint64_t componentMask(ComponentType type, Types... types)
+{
+    return (uint64_t(1) << type) | componentMask(types...);
+}
+
 /**
  * An Aspects is used by systems as a matcher against entities, to check if a system is
  * interested in an entity. Aspects define what sort of component types an entity must
@@ -33,6 +49,8 @@ namespace artemis
 class Aspect
 {
     friend class EntitySystem;
+    friend class CommandJournal;
+    friend class JournalReplayer;
 private:
     std::bitset<64> allSet;
     std::bitset<64> exclusionSet;
@@ -55,6 +73,23 @@ protected:
     }
 
 public:
+    /**
+     * Tells whether an entity with these components matches the sets of an aspect.
+     * An aspect with neither all nor one component types matches no entity.
+     *
+     * @param componentBits the component bits of the entity
+     */
+    static bool matches(const std::bitset<64> &allSet, const std::bitset<64> &exclusionSet, const std::bitset<64> &oneSet, const std::bitset<64> &componentBits);
+
+    bool matches(const std::bitset<64> &componentBits) const
+    {
+        return matches(allSet, exclusionSet, oneSet, componentBits);
+    }
+
+    bool operator==(const Aspect &other) const
+    {
+        return allSet == other.allSet && exclusionSet == other.exclusionSet && oneSet == other.oneSet;
+    }
 
     /**
      * Returns an aspect where an entity must possess all of the specified component types.
@@ -123,6 +158,23 @@ public:
         return aspect;
     }
 
+    /**
+     * Creates an aspect from component masks, see componentMask().
+     *
+     * @param all types the entity must possess
+     * @param exclusion types the entity must not possess
+     * @param one types of which the entity must possess one, if any
+     * @return an aspect that can be matched against entities
+     */
+    static Aspect * getAspectForMasks(uint64_t all, uint64_t exclusion = 0, uint64_t one = 0)
+    {
+        Aspect *aspect = new Aspect();
+        aspect->allSet = std::bitset<64>(all);
+        aspect->exclusionSet = std::bitset<64>(exclusion);
+        aspect->oneSet = std::bitset<64>(one);
+        return aspect;
+    }
+
     /**
      * Creates an aspect where an entity must possess one of the specified component types.
      *
@@ -0,0 +1,83 @@
+#ifndef Artemis_ComponentCodec_h__
+#define Artemis_ComponentCodec_h__
+
+#include "artemis/Component.h"
+#include <cstddef>
+#include <cstring>
+#include <type_traits>
+
+namespace artemis
+{
+
+/**
+ * Copies the data of a component class as plain bytes, for snapshots, rollback and
+ * replication. The data is everything the class adds to Component, so it only suits
+ * classes deriving from Component alone whose members are trivially copyable: no
+ * pointers to memory they own, no std::string or containers.
+ *
+ * Register a codec per type with World.registerComponent<T, type>().
+ */
+struct ComponentCodec
+{
+   size_t offset; // where the data of the class starts in the object
+   size_t size;
+   Component * (*create)();
+
+   bool isSet() const { return create != nullptr; }
+
+   void save(const Component *component, void *out) const
+   {
+      std::memcpy(out, reinterpret_cast<const char *>(component) + offset, size);
+   }
+
+   void load(Component *component, const void *in) const
+   {
+      std::memcpy(reinterpret_cast<char *>(component) + offset, in, size);
+   }
+
+   /**
+    * @return a new component of the class with the data of the given one.
+    */
+   Component * copy(const Component *component) const
+   {
+      Component *copied = create();
+      load(copied, reinterpret_cast<const char *>(component) + offset);
+      return copied;
+   }
+
+   /**
+    * @return the first byte a class derived from Component can place a member at.
+    */
+   static size_t getDataOffset()
+   {
+      struct Probe : Component
+      {
+         char data;
+         Probe(): Component(0), data(0) {}
+      };
+      Probe probe;
+      return reinterpret_cast<char *>(&probe.data) - reinterpret_cast<char *>(static_cast<Component *>(&probe));
+   }
+
+   template<typename T>
+   static Component * createComponent()
+   {
+      return new T();
+   }
+
+   template<typename T>
+   static ComponentCodec of()
+   {
+      static_assert(std::is_base_of<Component, T>::value, "component classes derive from Component");
+      static_assert(std::is_default_constructible<T>::value, "component classes need a default constructor to be restored");
+
+      ComponentCodec codec;
+      codec.offset = getDataOffset();
+      codec.size = sizeof(T) > codec.offset ? sizeof(T) - codec.offset : 0;
+      codec.create = &createComponent<T>;
+      return codec;
+   }
+};
+
+}
+#endif // Artemis_ComponentCodec_h__
@@ -1,6 +1,9 @@
 #include "artemis/ComponentManager.h"
 #include "artemis/Entity.h"
 #include "artemis/Component.h"
+#include "artemis/World.h"
+#include "artemis/utils/Instrumentation.h"
+#include <algorithm>
 
 namespace artemis
 {
@@ -16,27 +19,38 @@ void ComponentManager::removeComponentsOfEntity(Entity *e)
 
 void ComponentManager::addComponent(Entity *e, Component *component)
 {
+   ARTEMIS_ZONE("ComponentManager::addComponent");
    componentsByType.ensureCapacity(component->getType());
 
    Bag<Component*> *components = componentsByType.get(component->getType());
    if (components == nullptr) {
       components = new Bag<Component *>();
+      components->setIncrementalGrowth(incrementalGrowth);
+      components->setGrowthCounter(growthCounter);
       componentsByType.set(component->getType(), components);
    }
 
-   if (components->get(e->getId())) {
+   if (components->isIndexWithinBounds(e->getId()) && components->get(e->getId())) {
       removeComponent(e, component->getType()); // unusual situation, avoid it by logic
    }
    components->set(e->getId(), component);
 
    e->getComponentBits().set(component->getType());
+   markChanged(e->getId(), component->getType());
+
+   if (ChurnCounters *churn = world->getChurnCounters())
+      churn->componentAdded(component->getType());
 }
 
 Bag<Component *> * ComponentManager::getComponentsByType(ComponentType componentType)
 {
+   componentsByType.ensureCapacity(componentType);
+
    Bag<Component *> *components = componentsByType.get(componentType);
    if (components == nullptr) {
       components = new Bag<Component *>();
+      components->setIncrementalGrowth(incrementalGrowth);
+      components->setGrowthCounter(growthCounter);
       componentsByType.set(componentType, components);
    }
    return components;
@@ -45,16 +59,63 @@ Bag<Component *> * ComponentManager::getComponentsByType(ComponentType component
 void ComponentManager::removeComponent(Entity *e, ComponentType componentType )
 {
    if (e->getComponentBits().test(componentType)) {
+      ARTEMIS_ZONE("ComponentManager::removeComponent");
       delete componentsByType.get(componentType)->get(e->getId());
       componentsByType.get(componentType)->set(e->getId(), nullptr);
       e->getComponentBits().reset(componentType);
+      markChanged(e->getId(), componentType);
+
+      if (ChurnCounters *churn = world->getChurnCounters())
+         churn->componentRemoved(componentType);
+   }
+}
+
+void ComponentManager::addChangeTracker(ChangeTracker *tracker)
+{
+   changeTrackers.push_back(tracker);
+   trackedTypes |= tracker->getTypes();
+}
+
+void ComponentManager::removeChangeTracker(ChangeTracker *tracker)
+{
+   changeTrackers.erase(std::remove(changeTrackers.begin(), changeTrackers.end(), tracker), changeTrackers.end());
+   trackedTypes.reset();
+   for (size_t i = 0; i < changeTrackers.size(); ++i) {
+      trackedTypes |= changeTrackers[i]->getTypes();
+   }
+}
+
+void ComponentManager::notifyChanged(ComponentType componentType, int id)
+{
+   for (size_t i = 0; i < changeTrackers.size(); ++i) {
+      if (changeTrackers[i]->mTypes.test(componentType))
+         changeTrackers[i]->mark(componentType, id);
+   }
+}
+
+void ComponentManager::notifyChanged(Entity *e)
+{
+   std::bitset<64> bits = e->getComponentBits() & trackedTypes;
+   for (ComponentType t = 0; bits.any(); ++t) {
+      if (bits.test(t)) {
+         notifyChanged(t, e->getId());
+         bits.reset(t);
+      }
+   }
+}
+
+void ComponentManager::notifyDeleted(Entity *e)
+{
+   notifyChanged(e);
+   for (size_t i = 0; i < changeTrackers.size(); ++i) {
+      changeTrackers[i]->markDeleted(e->getId());
    }
 }
 
 Component * ComponentManager::getComponent(Entity *e, ComponentType componentType)
 {
-   Bag<Component *> *components = componentsByType.get(componentType);
-   if (components != nullptr) {
+   const Bag<Component *> *components = componentsByType.get(componentType);
+   if (components != nullptr && components->isIndexWithinBounds(e->getId())) {
       return components->get(e->getId());
    }
    return nullptr;
@@ -72,13 +133,66 @@ Bag<Component *> * ComponentManager::getComponentsFor(Entity *e, Bag<Component *
    return fillBag;
 }
 
-void ComponentManager::clean()
+void ComponentManager::reserve(size_t entities, const std::map<ComponentType, size_t> &perComponentHints)
+{
+   deletedEntities.reserve(entities);
+   for (auto it = perComponentHints.begin(); it != perComponentHints.end(); ++it) {
+      getComponentsByType(it->first)->reserve(it->second);
+   }
+}
+
+void ComponentManager::setIncrementalGrowth(bool incremental)
+{
+   deletedEntities.setIncrementalGrowth(incremental);
+   for (size_t i = 0; i < componentsByType.size(); ++i) {
+      if (componentsByType.get(i) != nullptr) {
+         componentsByType.get(i)->setIncrementalGrowth(incremental);
+      }
+   }
+   incrementalGrowth = incremental;
+}
+
+void ComponentManager::setGrowthCounter(uint64_t *growths)
+{
+   deletedEntities.setGrowthCounter(growths);
+   for (size_t i = 0; i < componentsByType.size(); ++i) {
+      if (componentsByType.get(i) != nullptr) {
+         componentsByType.get(i)->setGrowthCounter(growths);
+      }
+   }
+   growthCounter = growths;
+}
+
+void ComponentManager::reportComponents(MemoryReport &report) const
+{
+   for (size_t i = 0; i < componentsByType.size() && i < MemoryReport::MAX_TYPES; ++i) {
+      const Bag<Component *> *components = componentsByType.get(i);
+      if (components == nullptr)
+         continue;
+
+      size_t count = 0;
+      for (size_t j = 0; j < components->size(); ++j) {
+         if (components->get(j) != nullptr)
+            count++;
+      }
+      size_t size = i < componentSizes.size() && componentSizes.get(i) > 0 ? componentSizes.get(i) : sizeof(Component);
+      report.componentStorage[i].add(count * sizeof(Component *), components->getReservedBytes());
+      report.componentObjects[i].add(count * size, count * size);
+   }
+}
+
+void ComponentManager::clean(size_t budget)
 {
    if (deletedEntities.size() > 0) {
-      for (size_t i = 0; deletedEntities.size() > i; ++i) {
+      ARTEMIS_ZONE("ComponentManager::clean");
+      size_t n = deletedEntities.size();
+      if (budget > 0 && budget < n) {
+         n = budget;
+      }
+      for (size_t i = 0; n > i; ++i) {
          removeComponentsOfEntity(deletedEntities.get(i));
       }
-      deletedEntities.clear();
+      deletedEntities.removeFirst(n);
    }
 }
 
@@ -5,6 +5,10 @@
 #include "artemis/utils/Bag.h"
 #include "artemis/ComponentType.h"
 #include "artemis/Component.h"
+#include "artemis/ComponentCodec.h"
+#include "artemis/utils/ChangeTracker.h"
+#include <map>
+#include <vector>
 
 namespace artemis
 {
@@ -21,14 +25,25 @@ class ComponentManager : public Manager
 {
     friend class Entity;
     friend class World;
+    friend class ChangeTracker;
 private:
     Bag< Bag<Component *> *> componentsByType;
     Bag<Entity *> deletedEntities;
+    Bag<size_t> componentSizes;
+    Bag<ComponentCodec> componentCodecs;
+    bool incrementalGrowth;
+    uint64_t *growthCounter;
+    std::vector<ChangeTracker *> changeTrackers;
+    std::bitset<64> trackedTypes;
 
 public:
-    ComponentManager(): Manager(mtComponentManager) {}
+    ComponentManager(): Manager(mtComponentManager), incrementalGrowth(false), growthCounter(nullptr) {}
     ~ComponentManager()
     {
+        for (size_t i = 0; i < changeTrackers.size(); ++i)
+        {
+            changeTrackers[i]->mManager = nullptr;
+        }
         for (size_t i = 0; i < componentsByType.size(); ++i)
         {
             Bag<Component *> *p = componentsByType.get(i);
@@ -48,6 +63,11 @@ protected:
 
 private:
     void removeComponentsOfEntity(Entity *e);
+    void addChangeTracker(ChangeTracker *tracker);
+    void removeChangeTracker(ChangeTracker *tracker);
+    void notifyChanged(ComponentType componentType, int id);
+    void notifyChanged(Entity *e);
+    void notifyDeleted(Entity *e);
 
 protected:
     void addComponent(Entity *e, Component *component);
@@ -61,12 +81,107 @@ public:
     Bag<Component *> * getComponentsFor(Entity *e, Bag<Component *> *fillBag);
 
 
+    void added(Entity *e) override
+    {
+        if (trackedTypes.any())
+            notifyChanged(e);
+    }
+
     void deleted(Entity *e) override
     {
         deletedEntities.add(e);
+        if (!changeTrackers.empty())
+            notifyDeleted(e);
+    }
+
+    /**
+     * Tells the change trackers of a type that the component of an entity is
+     * being written, see ChangeTracker. Does nothing if the type is not tracked.
+     */
+    void markChanged(int entityId, ComponentType componentType)
+    {
+        if (trackedTypes.test(componentType))
+            notifyChanged(componentType, entityId);
+    }
+
+    /**
+     * Presizes storage so that it does not grow during frames.
+     * Component storage is indexed by entity id, so a hint should cover the id range
+     * of the entities that will hold that component type.
+     *
+     * @param entities number of entities expected to be deleted in one frame.
+     * @param perComponentHints storage capacity per component type.
+     */
+    void reserve(size_t entities, const std::map<ComponentType, size_t> &perComponentHints);
+
+    /**
+     * Sets the growth policy of all component storage, see Bag.setIncrementalGrowth().
+     */
+    void setIncrementalGrowth(bool incremental);
+
+    /**
+     * Counts the growths of all component storage, see Bag.setGrowthCounter().
+     */
+    void setGrowthCounter(uint64_t *growths);
+
+    /**
+     * Get how many deleted entities still have their components waiting to be removed.
+     * @return how many deleted entities are not cleaned yet.
+     */
+    size_t getPendingCleanCount() const
+    {
+        return deletedEntities.size();
     }
 
-    void clean();
+    /**
+     * Removes the components of entities deleted from the world.
+     *
+     * @param budget maximum number of deleted entities to clean in this call,
+     *               the rest are kept in order for later calls. 0 cleans them all.
+     */
+    void clean(size_t budget = 0);
+
+    /**
+     * Sets the size of the component class of a type, for memory reports.
+     * ComponentMappers set it for their type when the world is initialized,
+     * types without a mapper count as sizeof(Component) otherwise.
+     */
+    void setComponentSize(ComponentType componentType, size_t bytes)
+    {
+        componentSizes.set(componentType, bytes);
+    }
+
+    /**
+     * Sets how the data of the component class of a type is copied as bytes,
+     * see World.registerComponent().
+     */
+    void setComponentCodec(ComponentType componentType, const ComponentCodec &codec)
+    {
+        componentCodecs.set(componentType, codec);
+    }
+
+    /**
+     * @return the codec of a component type, null if none was set.
+     */
+    const ComponentCodec * getComponentCodec(ComponentType componentType) const
+    {
+        if (!componentCodecs.isIndexWithinBounds(componentType) || !componentCodecs.get(componentType).isSet())
+            return nullptr;
+        return &componentCodecs.get(componentType);
+    }
+
+    /**
+     * Adds the component storage and component objects of each type to the report.
+     */
+    void reportComponents(MemoryReport &report) const;
+
+    void reportMemory(MemoryUsage &usage) const override
+    {
+        usage.add(componentsByType.getUsedBytes(), componentsByType.getReservedBytes());
+        usage.add(deletedEntities.getUsedBytes(), deletedEntities.getReservedBytes());
+        usage.add(componentSizes.getUsedBytes(), componentSizes.getReservedBytes());
+        usage.add(componentCodecs.getUsedBytes(), componentCodecs.getReservedBytes());
+    }
 
 };
 }
@@ -9,4 +9,14 @@ Bag<Component *> * ComponentMapperHelper::getComponents( World *w, ComponentType
 {
    return w->getComponentManager()->getComponentsByType(tp);
 }
+
+ComponentManager * ComponentMapperHelper::getComponentManager( World *w )
+{
+   return w->getComponentManager();
+}
+
+void ComponentMapperHelper::setComponentSize( World *w, ComponentType tp, size_t bytes )
+{
+   w->getComponentManager()->setComponentSize(tp, bytes);
+}
 }
\ No newline at end of file
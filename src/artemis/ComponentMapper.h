@@ -4,6 +4,7 @@
 #include "artemis/ComponentType.h"
 #include "artemis/utils/Bag.h"
 #include "artemis/Component.h"
+#include "artemis/ComponentManager.h"
 #include "artemis/Entity.h"
 
 namespace artemis
@@ -23,6 +24,8 @@ class ComponentMapperHelper
 {
 public:
    static Bag<Component *> *getComponents(World *w, ComponentType tp);
+   static ComponentManager *getComponentManager(World *w);
+   static void setComponentSize(World *w, ComponentType tp, size_t bytes);
 };
 
 class BaseComponentMapper
@@ -36,15 +39,18 @@ template<typename T, ComponentType cType>
 class ComponentMapper : public BaseComponentMapper
 {
 private:
-   Bag<Component *> *components;
+   const Bag<Component *> *components;
+   ComponentManager *manager;
 
 protected:
    void init(World *w) override
    {
       components = ComponentMapperHelper::getComponents(w, cType);
+      manager = ComponentMapperHelper::getComponentManager(w);
+      ComponentMapperHelper::setComponentSize(w, cType, sizeof(T));
    }
 public:
-   ComponentMapper(): components(nullptr) {}
+   ComponentMapper(): components(nullptr), manager(nullptr) {}
 	/**
 	 * Fast but unsafe retrieval of a component for this entity.
 	 * No bounding checks, so this could throw an ArrayIndexOutOfBoundsExeption,
@@ -57,6 +63,18 @@ public:
 		return static_cast<T *>(components->get(e->getId()));
 	}
 
+	/**
+	 * Fast but unsafe retrieval of a component that is about to be written, so
+	 * that change tracking (rollback, replication) sees the change.
+	 *
+	 * @param e the entity that should possess the component
+	 * @return the instance of the component
+	 */
+   T * edit(Entity *e) {
+		manager->markChanged(e->getId(), cType);
+		return static_cast<T *>(components->get(e->getId()));
+	}
+
 	/**
 	 * Fast and safe retrieval of a component for this entity.
 	 * If the entity does not have this component then null is returned.
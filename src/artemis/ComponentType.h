@@ -11,5 +11,22 @@ namespace artemis
  *
  */
 typedef unsigned int ComponentType;
+
+/**
+ * The component type of a component class, known at compile time, e.g. by View.
+ * It is the class's static TYPE member:
+ *
+ * struct Position : Component {
+ *    static const ComponentType TYPE = ctPosition;
+ *    Position(): Component(TYPE) {}
+ * };
+ *
+ * Specialize it for classes without one.
+ */
+template<typename T>
+struct ComponentTypeOf
+{
+   static const ComponentType value = T::TYPE;
+};
 }
 #endif // Artemis_ComponentType_h__
@@ -16,12 +16,16 @@ Entity::Entity( World *world, int id ) : world(world), id(id)
 }
 
 Entity * Entity::addComponent(Component *component) {
+   if (CommandJournal *journal = world->getJournal())
+      journal->recordComponent(this, component);
    componentManager->addComponent(this, component);
    return this;
 }
 
 Entity * Entity::removeComponent(ComponentType componentType)
 {
+   if (CommandJournal *journal = world->getJournal())
+      journal->recordRemoveComponent(this, componentType);
    componentManager->removeComponent(this, componentType);
    return this;
 }
@@ -46,6 +50,14 @@ Component * Entity::getComponent(ComponentType componentType)
    return componentManager->getComponent(this, componentType);
 }
 
+Component * Entity::editComponent(ComponentType componentType)
+{
+   Component *component = componentManager->getComponent(this, componentType);
+   if (component != nullptr)
+      componentManager->markChanged(id, componentType);
+   return component;
+}
+
 Bag<Component *> * Entity::getComponents(Bag<Component *> *fillBag)
 {
    return componentManager->getComponentsFor(this, fillBag);
@@ -177,6 +177,19 @@ public:
 		return static_cast<T *>(getComponent(tp));
 	}
 
+	/**
+	 * Retrieves a component that is about to be written, so that change tracking
+	 * (rollback, replication) sees the change.
+	 *
+	 * @return the component, or null if the entity has none of that type.
+	 */
+	Component * editComponent(ComponentType componentType);
+
+   template<typename T>
+	T * editComponent(ComponentType tp) {
+		return static_cast<T *>(editComponent(tp));
+	}
+
 	/**
 	 * Returns a bag of all components this entity has.
 	 * You need to reset the bag yourself if you intend to fill it more than once.
@@ -1,6 +1,9 @@
 #include "artemis/EntityManager.h"
 #include "artemis/ManagerType.h"
 #include "artemis/Entity.h"
+#include "artemis/ComponentManager.h"
+#include "artemis/World.h"
+#include "artemis/utils/Instrumentation.h"
 
 namespace artemis
 {
@@ -11,11 +14,30 @@ EntityManager::EntityManager() : Manager(mtEntityManager), mActiveCnt(0), mAdded
 
 Entity * EntityManager::createEntityInstance()
 {
+   ARTEMIS_ZONE("EntityManager::createEntityInstance");
    Entity *e = new Entity(world, identifierPool.checkOut());
    mCreatedCnt++;
    return e;
 }
 
+Entity * EntityManager::createEntityInstance(int id)
+{
+   Entity *e = new Entity(world, id);
+   mCreatedCnt++;
+   return e;
+}
+
+void EntityManager::createEntityInstances(Entity **out, size_t count)
+{
+   ARTEMIS_ZONE("EntityManager::createEntityInstances");
+   int first = identifierPool.checkOutBlock(count);
+   for (size_t i = 0; i < count; ++i) {
+      out[i] = new Entity(world, first + static_cast<int>(i));
+   }
+   mCreatedCnt += count;
+   mEntities.ensureCapacity(first + count);
+}
+
 void EntityManager::added( Entity *e )
 {
    mActiveCnt++;
@@ -25,35 +47,89 @@ void EntityManager::added( Entity *e )
 
 void EntityManager::enabled( Entity *e )
 {
-   mDisabledEntities.reset(e->getId());
+   size_t id = e->getId();
+   if (id < mDisabledEntities.size()) {
+      mDisabledEntities[id] = false;
+   }
 }
 
 void EntityManager::disabled( Entity *e )
 {
-   mDisabledEntities.set(e->getId());
+   size_t id = e->getId();
+   if (id >= mDisabledEntities.size()) {
+      mDisabledEntities.resize(id + 1, false);
+   }
+   mDisabledEntities[id] = true;
 }
 
 void EntityManager::deleted( Entity *e )
 {
-   mDisabledEntities.reset(e->getId());
-   mDeletedEntities.set(e->getId());
+   size_t id = e->getId();
+   if (id < mDisabledEntities.size()) {
+      mDisabledEntities[id] = false;
+   }
+   // Hide the entity right away, it is reclaimed later in clean().
+   if (id < mEntities.size() && mEntities.get(id) == e) {
+      mEntities.set(id, nullptr);
+   }
+   mDeletedEntities.add(e);
    mActiveCnt--;
 }
 
+void EntityManager::reserve(size_t entities)
+{
+   mEntities.reserve(entities);
+   mDeletedEntities.reserve(entities);
+   mDisabledEntities.reserve(entities);
+   identifierPool.reserve(entities);
+}
+
+void EntityManager::setIncrementalGrowth(bool incremental)
+{
+   mEntities.setIncrementalGrowth(incremental);
+   mDeletedEntities.setIncrementalGrowth(incremental);
+}
+
+void EntityManager::setGrowthCounter(uint64_t *growths)
+{
+   mEntities.setGrowthCounter(growths);
+   mDeletedEntities.setGrowthCounter(growths);
+}
+
 void EntityManager::clean()
 {
-   if (mDeletedEntities.any()) {
-      for (size_t i = 0; i < mDeletedEntities.size(); ++i) {
-         if (mDeletedEntities.test(i)) {
-            Entity *ent = mEntities.get(i);
-            mEntities.set(ent->getId(), nullptr);
-            identifierPool.checkIn(ent->getId());
-            delete ent;
-            mDeletedCnt++;
-         }
+   // ComponentManager drains the same deletions in the same order, so everything
+   // in front of its pending ones has no components left and can be reclaimed.
+   size_t pending = world->getComponentManager()->getPendingCleanCount();
+   if (mDeletedEntities.size() > pending) {
+      ARTEMIS_ZONE("EntityManager::clean");
+      size_t n = mDeletedEntities.size() - pending;
+      for (size_t i = 0; i < n; ++i) {
+         Entity *ent = mDeletedEntities.get(i);
+         identifierPool.checkIn(ent->getId());
+         delete ent;
+         mDeletedCnt++;
       }
+      mDeletedEntities.removeFirst(n);
    }
-   mDeletedEntities.reset();
+}
+
+void EntityManager::reportEntities(MemoryReport &report) const
+{
+   size_t count = mDeletedEntities.size();
+   for (size_t i = 0; i < mEntities.size(); ++i) {
+      if (mEntities.get(i) != nullptr)
+         count++;
+   }
+   report.entities.add(count * sizeof(Entity), count * sizeof(Entity));
+   report.entities.add(mEntities.getUsedBytes(), mEntities.getReservedBytes());
+   identifierPool.reportMemory(report.identifierPool);
+}
+
+void EntityManager::reportMemory(MemoryUsage &usage) const
+{
+   usage.add(mDeletedEntities.getUsedBytes(), mDeletedEntities.getReservedBytes());
+   usage.add((mDisabledEntities.size() + 7) / 8, (mDisabledEntities.capacity() + 7) / 8);
 }
 
 EntityManager::~EntityManager()
@@ -61,6 +137,9 @@ EntityManager::~EntityManager()
    for (size_t i = 0; i < mEntities.size(); ++i) {
       delete mEntities.get(i);
    }
+   for (size_t i = 0; i < mDeletedEntities.size(); ++i) {
+      delete mDeletedEntities.get(i);
+   }
 }
 
 
@@ -3,7 +3,6 @@
 
 #include "artemis/Manager.h"
 #include "artemis/utils/Bag.h"
-#include <bitset>
 #include <vector>
 
 namespace artemis
@@ -35,12 +34,37 @@ private:
       ~IdentifierPool() {}
 		
 		int checkOut();
+		/*
+		 * Takes count consecutive ids that were never used, returns the first.
+		 */
+		int checkOutBlock(size_t count)
+		{
+			int first = nextAvailableId;
+			nextAvailableId += static_cast<unsigned int>(count);
+			return first;
+		}
 		void checkIn(int id);
+		void reserve(size_t ids) { mIds.reserve(ids); }
+		unsigned int getNextAvailableId() const { return nextAvailableId; }
+		const std::vector<unsigned int> & getFreeIds() const { return mIds; }
+		void restore(unsigned int nextId, const unsigned int *freeIds, size_t count)
+		{
+			nextAvailableId = nextId;
+			mIds.assign(freeIds, freeIds + count);
+		}
+		void reportMemory(MemoryUsage &usage) const
+		{
+			usage.add(mIds.size() * sizeof(unsigned int), mIds.capacity() * sizeof(unsigned int));
+		}
 	};
 
    Bag<Entity *> mEntities;
-	std::bitset<64> mDisabledEntities;
-   std::bitset<64> mDeletedEntities;
+   std::vector<bool> mDisabledEntities;
+   /*
+    * Entities deleted from the world whose memory and ids are not reclaimed yet,
+    * in the order they were deleted.
+    */
+   Bag<Entity *> mDeletedEntities;
 	
 	int mActiveCnt;
 	long int mAddedCnt;
@@ -56,6 +80,15 @@ public:
 protected:
    void initialize() override {}
 	Entity * createEntityInstance();
+	/*
+	 * Creates an entity with an id restored from a snapshot, the id pool must
+	 * already account for it.
+	 */
+	Entity * createEntityInstance(int id);
+	/*
+	 * Creates entities with a block of consecutive ids.
+	 */
+	void createEntityInstances(Entity **out, size_t count);
 	
 public:
    void added(Entity *e) override;
@@ -72,7 +105,7 @@ public:
 	 * @return true if active, false if not.
 	 */
 	bool isActive(int entityId) {
-		return mEntities.get(entityId) != nullptr;
+		return mEntities.isIndexWithinBounds(entityId) && mEntities.get(entityId) != nullptr;
 	}
 	
 	/**
@@ -82,7 +115,7 @@ public:
 	 * @return true if the entity is enabled, false if it is disabled.
 	 */
 	bool isEnabled(int entityId) {
-		return !mDisabledEntities.test(entityId);
+		return static_cast<size_t>(entityId) >= mDisabledEntities.size() || !mDisabledEntities[entityId];
 	}
 	
 	/**
@@ -93,7 +126,7 @@ public:
 	 */
 protected:
    Entity * getEntity(int entityId) {
-		return mEntities.get(entityId);
+		return mEntities.isIndexWithinBounds(entityId) ? mEntities.get(entityId) : nullptr;
 	}
 	
 	/**
@@ -123,6 +156,42 @@ public:
 	 */
 	long int getTotalDeleted() { return mDeletedCnt; }
 
+	/**
+	 * Presizes entity storage and the id pool for the given number of entities.
+	 * @param entities number of entities expected to be alive at once.
+	 */
+	void reserve(size_t entities);
+
+	/**
+	 * Sets the growth policy of entity storage, see Bag.setIncrementalGrowth().
+	 */
+	void setIncrementalGrowth(bool incremental);
+
+	/**
+	 * Counts the growths of entity storage, see Bag.setGrowthCounter().
+	 */
+	void setGrowthCounter(uint64_t *growths);
+
+	/**
+	 * Get how many deleted entities are still waiting to be reclaimed.
+	 * Their ids are not reused until they are.
+	 * @return how many deleted entities are not reclaimed yet.
+	 */
+	size_t getPendingCleanCount() const { return mDeletedEntities.size(); }
+
+	/**
+	 * Adds the Entity objects added to the world or waiting to be reclaimed, the
+	 * entity table and the identifier pool to the report. Entities created but
+	 * never added to the world are not known here.
+	 */
+	void reportEntities(MemoryReport &report) const;
+
+	void reportMemory(MemoryUsage &usage) const override;
+
+	/**
+	 * Reclaims deleted entities whose components have already been removed
+	 * by the ComponentManager, and returns their ids to the pool.
+	 */
    void clean();
 };
 }
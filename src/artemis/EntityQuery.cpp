@@ -0,0 +1,56 @@
+#include "artemis/EntityQuery.h"
+#include "artemis/Aspect.h"
+#include "artemis/Entity.h"
+#include "artemis/World.h"
+
+namespace artemis
+{
+
+EntityQuery::EntityQuery(World *world, Aspect *aspect): world(world), mAspect(aspect)
+{
+}
+
+EntityQuery::~EntityQuery()
+{
+   if (world)
+      world->removeQuery(this);
+   delete mAspect;
+}
+
+bool EntityQuery::contains(Entity *e) const
+{
+   return contains(e->getId()) && mEntities.get(mIndices[e->getId()]) == e;
+}
+
+void EntityQuery::insert(Entity *e)
+{
+   size_t id = e->getId();
+   if (id >= mIndices.size())
+      mIndices.resize(id + 1, -1);
+   mIndices[id] = static_cast<int>(mEntities.size());
+   mEntities.add(e);
+}
+
+void EntityQuery::remove(Entity *e)
+{
+   if (!contains(e->getId()))
+      return;
+   int index = mIndices[e->getId()];
+   mIndices[e->getId()] = -1;
+   mEntities.removeAt(index);
+   if (static_cast<size_t>(index) < mEntities.size())
+      mIndices[mEntities.get(index)->getId()] = index;
+}
+
+void EntityQuery::check(Entity *e)
+{
+   bool interested = mAspect->matches(e->getComponentBits()) && e->isEnabled();
+   bool present = contains(e->getId());
+   if (interested && !present) {
+      insert(e);
+   } else if (!interested && present) {
+      remove(e);
+   }
+}
+
+}
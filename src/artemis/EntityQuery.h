@@ -0,0 +1,71 @@
+#ifndef Artemis_EntityQuery_h__
+#define Artemis_EntityQuery_h__
+
+#include "artemis/EntityObserver.h"
+#include "artemis/utils/Bag.h"
+#include "artemis/utils/MemoryReport.h"
+#include <bitset>
+#include <memory>
+#include <vector>
+
+namespace artemis
+{
+class Aspect;
+class Entity;
+class World;
+
+/**
+ * The entities matching an aspect, kept up to date by the world like the actives of
+ * a system but without registering one: get it with World.query(), iterate it as
+ * often as needed and drop it when done. Queries for identical aspects share one
+ * result, which is deleted when the last reference to it goes away.
+ *
+ * A query does not take a system bit, it keeps its own index of its entities. Like
+ * systems, it sees entities added, changed, enabled, disabled or deleted on the
+ * next World.process().
+ */
+class EntityQuery : public EntityObserver, public std::enable_shared_from_this<EntityQuery>
+{
+   friend class World;
+private:
+   World *world;
+   Aspect *mAspect;
+   Bag<Entity *> mEntities;
+   std::vector<int> mIndices; // position of each entity in mEntities by id, -1 if not in it
+
+   EntityQuery(World *world, Aspect *aspect);
+   EntityQuery(const EntityQuery &) = delete;
+   EntityQuery & operator=(const EntityQuery &) = delete;
+
+   bool contains(int id) const { return static_cast<size_t>(id) < mIndices.size() && mIndices[id] >= 0; }
+   void insert(Entity *e);
+   void remove(Entity *e);
+   void check(Entity *e);
+
+public:
+   ~EntityQuery();
+
+   /**
+    * @return the matching entities, in no particular order.
+    */
+   const Bag<Entity *> & getEntities() const { return mEntities; }
+
+   size_t size() const { return mEntities.size(); }
+   Entity * get(size_t index) const { return mEntities.get(index); }
+   bool contains(Entity *e) const;
+
+   void added(Entity *e) override { check(e); }
+   void changed(Entity *e) override { check(e); }
+   void deleted(Entity *e) override { remove(e); }
+   void enabled(Entity *e) override { check(e); }
+   void disabled(Entity *e) override { remove(e); }
+
+   void reportMemory(MemoryUsage &usage) const
+   {
+      usage.add(mEntities.getUsedBytes(), mEntities.getReservedBytes());
+      usage.add(mIndices.size() * sizeof(int), mIndices.capacity() * sizeof(int));
+   }
+};
+
+}
+#endif // Artemis_EntityQuery_h__
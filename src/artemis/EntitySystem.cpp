@@ -1,6 +1,9 @@
 #include "artemis/EntitySystem.h"
 #include "artemis/Aspect.h"
 #include "artemis/Entity.h"
+#include "artemis/World.h"
+#include "artemis/utils/FrameProfiler.h"
+#include "artemis/utils/Instrumentation.h"
 
 namespace artemis
 {
@@ -18,39 +21,22 @@ EntitySystem::~EntitySystem()
 {
 }
 
+bool EntitySystem::isInterested(const std::bitset<64> &componentBits) const
+{
+   return !dummy && Aspect::matches(allSet, exclusionSet, oneSet, componentBits);
+}
+
 void EntitySystem::check(Entity *e)
 {
    if (dummy) {
       return;
    }
 
-   bool contains = e->getSystemBits().test(mType);
-   bool interested = true; // possibly interested, let's try to prove it wrong.
-
-   std::bitset<64> &componentBits = e->getComponentBits();
-
-   // Check if the entity possesses ALL of the components defined in the aspect.
-   if (!allSet.none()) {
-      if ((allSet & componentBits) != allSet) {
-         interested = false;
-      }
-      /*for (size_t i = 0; i < allSet.count(); ++i) {
-         if (allSet.test(i) && !componentBits.test(i)) {
-            interested = false;
-            break;
-         }
-      }*/
-   }
-
-   // Check if the entity possesses ANY of the exclusion components, if it does then the system is not interested.
-   if (!exclusionSet.none() && interested) {
-      interested = !((exclusionSet & componentBits).any());
-   }
+   if (ChurnCounters *churn = world->getChurnCounters())
+      churn->checked();
 
-   // Check if the entity possesses ANY of the components in the oneSet. If so, the system is interested.
-   if (!oneSet.none()) {
-      interested = (oneSet & componentBits).any();
-   }
+   bool contains = e->getSystemBits().test(mType);
+   bool interested = isInterested(e->getComponentBits());
 
    if (interested && !contains) {
       insertToSystem(e);
@@ -59,20 +45,86 @@ void EntitySystem::check(Entity *e)
    }
 }
 
+void EntitySystem::check(Entity *const *entities, size_t count)
+{
+   if (dummy) {
+      return;
+   }
+
+   ChurnCounters *churn = world->getChurnCounters();
+   std::vector<Entity *> leaving;
+   for (size_t i = 0; i < count; ++i) {
+      Entity *e = entities[i];
+      if (churn)
+         churn->checked();
+
+      bool contains = e->getSystemBits().test(mType);
+      bool interested = isInterested(e->getComponentBits());
+      if (interested && !contains) {
+         insertToSystem(e);
+      } else if (!interested && contains) {
+         leaving.push_back(e);
+      }
+   }
+   removeFromSystem(leaving.data(), leaving.size());
+}
+
 void EntitySystem::removeFromSystem(Entity *e)
 {
    mActives.remove(e);
    e->getSystemBits().reset(mType);
+   if (ChurnCounters *churn = world->getChurnCounters())
+      churn->systemRemoved(mType);
    removed(e);
 }
 
+void EntitySystem::removeFromSystem(Entity *const *entities, size_t count)
+{
+   // Clear the system bit of the members, then drop every active entity without it in one sweep.
+   std::vector<Entity *> members;
+   for (size_t i = 0; i < count; ++i) {
+      if (entities[i]->getSystemBits().test(mType)) {
+         entities[i]->getSystemBits().reset(mType);
+         members.push_back(entities[i]);
+      }
+   }
+   if (members.empty())
+      return;
+
+   EntitySystemType type = mType;
+   mActives.removeIf([type](Entity *e) { return !e->getSystemBits().test(type); });
+
+   ChurnCounters *churn = world->getChurnCounters();
+   for (size_t i = 0; i < members.size(); ++i) {
+      if (churn)
+         churn->systemRemoved(mType);
+      removed(members[i]);
+   }
+}
+
 void EntitySystem::insertToSystem(Entity *e)
 {
    mActives.add(e);
    e->getSystemBits().set(mType);
+   if (ChurnCounters *churn = world->getChurnCounters())
+      churn->systemInserted(mType);
    inserted(e);
 }
 
+void EntitySystem::insertToSystem(Entity *const *entities, size_t count)
+{
+   mActives.ensureCapacity(mActives.size() + count);
+   ChurnCounters *churn = world->getChurnCounters();
+   for (size_t i = 0; i < count; ++i) {
+      Entity *e = entities[i];
+      mActives.add(e);
+      e->getSystemBits().set(mType);
+      if (churn)
+         churn->systemInserted(mType);
+      inserted(e);
+   }
+}
+
 void EntitySystem::deleted(Entity *e)
 {
    if (e->getSystemBits().test(mType)) {
@@ -104,10 +156,25 @@ void EntitySystem::enabled( Entity *e )
 
 void EntitySystem::process()
 {
+   ARTEMIS_ZONE("EntitySystem::process");
+   FrameProfiler *profiler = world->getProfiler();
+   if (profiler == nullptr) {
+      if (checkProcessing()) {
+         begin();
+         processEntities(&mActives);
+         end();
+      }
+      return;
+   }
+
    if (checkProcessing()) {
+      uint64_t start = FrameProfiler::now();
       begin();
+      uint64_t afterBegin = FrameProfiler::now();
       processEntities(&mActives);
+      uint64_t afterProcess = FrameProfiler::now();
       end();
+      profiler->recordSystem(mType, start, afterBegin, afterProcess, FrameProfiler::now());
    }
 }
 
@@ -4,6 +4,7 @@
 #include "artemis/EntitySystemType.h"
 #include "artemis/EntityObserver.h"
 #include "artemis/utils/Bag.h"
+#include "artemis/utils/MemoryReport.h"
 #include <bitset>
 #include <vector>
 
@@ -25,6 +26,7 @@ class BaseComponentMapper;
 class EntitySystem : public EntityObserver
 {
    friend class World;
+   template<typename... Systems> friend class StaticWorld;
 private:
    World *world;
    EntitySystemType mType;
@@ -98,9 +100,29 @@ protected:
 	 */
 	void check(Entity *e);
 
+	/**
+	 * Tells whether the system is interested in entities with these components.
+	 * @param componentBits component bits of an entity
+	 */
+	bool isInterested(const std::bitset<64> &componentBits) const;
+
+	/*
+	 * Checks entities whose components changed, dropping those no longer of
+	 * interest in a single sweep over the actives.
+	 */
+	void check(Entity *const *entities, size_t count);
+
 private:
    void removeFromSystem(Entity *e);
+	/*
+	 * Removes the entities that are in the system with a single sweep over the actives.
+	 */
+	void removeFromSystem(Entity *const *entities, size_t count);
 	void insertToSystem(Entity *e);
+	/*
+	 * Inserts entities known to be of interest and not in the system yet.
+	 */
+	void insertToSystem(Entity *const *entities, size_t count);
 
 public:
    void added(Entity *e) override;
@@ -116,6 +138,32 @@ protected:
 	void setPassive(bool passive) { this->passive = passive; }
 public:
    const Bag<Entity *> * getActives() const { return &mActives; }
+
+   /**
+    * Presizes the active entities of this system so inserts do not grow it during frames.
+    * @param entities number of entities this system is expected to hold.
+    */
+   void reserve(size_t entities) { mActives.reserve(entities); }
+
+   /**
+    * Sets the growth policy of the active entities, see Bag.setIncrementalGrowth().
+    */
+   void setIncrementalGrowth(bool incremental) { mActives.setIncrementalGrowth(incremental); }
+
+   /**
+    * Counts the growths of the active entities, see Bag.setGrowthCounter().
+    */
+   void setGrowthCounter(uint64_t *growths) { mActives.setGrowthCounter(growths); }
+
+   /**
+    * Adds the memory held by the active entities and mapper table of this system,
+    * override to add the system's own containers. See World.memoryReport().
+    */
+   virtual void reportMemory(MemoryUsage &usage) const
+   {
+      usage.add(mActives.getUsedBytes(), mActives.getReservedBytes());
+      usage.add(mRegisteredMappers.getUsedBytes(), mRegisteredMappers.getReservedBytes());
+   }
 };
 }
 #endif // Artemis_EntitySystem_h__
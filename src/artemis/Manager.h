@@ -3,6 +3,7 @@
 
 #include "artemis/EntityObserver.h"
 #include "artemis/ManagerType.h"
+#include "artemis/utils/MemoryReport.h"
 
 namespace artemis
 {
@@ -34,6 +35,11 @@ public:
 	void deleted(Entity *e) override {}
 	void disabled(Entity *e) override {}
 	void enabled(Entity *e) override {}
+
+	/**
+	 * Adds the memory held by this manager's containers, see World.memoryReport().
+	 */
+	virtual void reportMemory(MemoryUsage &usage) const {}
 };
 }
 #endif // Artemis_Manager_h__
\ No newline at end of file
@@ -18,6 +18,7 @@ enum ManagerTypes {
    mtPlayerManager,
    mtTagManager,
    mtTeamManager,
+   mtRollbackManager,
    mtDEFAULT_MANAGERS_CNT
 };
 }
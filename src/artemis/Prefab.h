@@ -0,0 +1,127 @@
+#ifndef Artemis_Prefab_h__
+#define Artemis_Prefab_h__
+
+#include "artemis/Component.h"
+#include "artemis/ComponentType.h"
+#include <bitset>
+#include <type_traits>
+#include <vector>
+
+namespace artemis
+{
+
+/**
+ * A template for spawning many copies of the same entity: a set of components with
+ * their default values. Every entity made from it by World.instantiate() gets a copy
+ * of each component, made with the copy constructor of its class, and the systems
+ * it belongs to are worked out once per instantiate() instead of once per entity.
+ *
+ * Prefab prefab;
+ * prefab.add(Position(0, 0))->add(Velocity(1, 0));
+ * world.instantiate(&prefab, 1000);
+ */
+class Prefab
+{
+private:
+   struct Entry
+   {
+      Component *prototype;
+      Component * (*clone)(const Component *);
+   };
+
+   std::vector<Entry> mComponents;
+   std::bitset<64> componentBits;
+
+   Prefab(const Prefab &) = delete;
+   Prefab & operator=(const Prefab &) = delete;
+
+   template<typename T>
+   static Component * cloneComponent(const Component *prototype)
+   {
+      return new T(*static_cast<const T *>(prototype));
+   }
+
+public:
+   Prefab() {}
+   ~Prefab()
+   {
+      for (size_t i = 0; i < mComponents.size(); ++i) {
+         delete mComponents[i].prototype;
+      }
+   }
+
+   /**
+    * Adds a component with the values of the given one, replacing a component of
+    * the same type added before.
+    *
+    * @param prototype the default values, copied.
+    * @return this prefab for chaining.
+    */
+   template<typename T>
+   Prefab * add(const T &prototype)
+   {
+      static_assert(std::is_base_of<Component, T>::value, "component classes derive from Component");
+      static_assert(std::is_copy_constructible<T>::value, "prefab components are copied with their copy constructor");
+
+      remove(prototype.getType());
+      Entry entry;
+      entry.prototype = new T(prototype);
+      entry.clone = &cloneComponent<T>;
+      mComponents.push_back(entry);
+      componentBits.set(prototype.getType());
+      return this;
+   }
+
+   /**
+    * Removes the component of a type.
+    *
+    * @return this prefab for chaining.
+    */
+   Prefab * remove(ComponentType type)
+   {
+      for (size_t i = 0; i < mComponents.size(); ++i) {
+         if (mComponents[i].prototype->getType() == type) {
+            delete mComponents[i].prototype;
+            mComponents.erase(mComponents.begin() + i);
+            componentBits.reset(type);
+            break;
+         }
+      }
+      return this;
+   }
+
+   /**
+    * Gives the default values of a component type, to change them between instantiations.
+    *
+    * @return the component of the prefab, null if it has none of that type.
+    */
+   template<typename T>
+   T * getPrototype(ComponentType type)
+   {
+      for (size_t i = 0; i < mComponents.size(); ++i) {
+         if (mComponents[i].prototype->getType() == type)
+            return static_cast<T *>(mComponents[i].prototype);
+      }
+      return nullptr;
+   }
+
+   /**
+    * @return the bits of the component types of the prefab, the component bits of its entities.
+    */
+   const std::bitset<64> & getComponentBits() const { return componentBits; }
+
+   size_t getComponentCount() const { return mComponents.size(); }
+
+   ComponentType getComponentType(size_t index) const { return mComponents[index].prototype->getType(); }
+
+   /**
+    * @return a new copy of the component at index.
+    */
+   Component * createComponent(size_t index) const
+   {
+      return mComponents[index].clone(mComponents[index].prototype);
+   }
+};
+
+}
+#endif // Artemis_Prefab_h__
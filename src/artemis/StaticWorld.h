@@ -0,0 +1,186 @@
+#ifndef Artemis_StaticWorld_h__
+#define Artemis_StaticWorld_h__
+
+#include "artemis/EntitySystem.h"
+#include "artemis/EntitySystemType.h"
+#include "artemis/View.h"
+#include "artemis/World.h"
+#include "artemis/utils/AllocationTracker.h"
+#include "artemis/utils/Instrumentation.h"
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+namespace artemis
+{
+
+template<typename S, typename... Systems>
+struct StaticSystemIndex;
+
+template<typename S, typename... Systems>
+struct StaticSystemIndex<S, S, Systems...>
+{
+   static const size_t value = 0;
+};
+
+template<typename S, typename T, typename... Systems>
+struct StaticSystemIndex<S, T, Systems...>
+{
+   static const size_t value = 1 + StaticSystemIndex<S, Systems...>::value;
+};
+
+/*
+ * Whether a system class is processed by its own processStatic(), i.e. derives
+ * from StaticEntityProcessingSystem<S> or StaticIntervalEntityProcessingSystem<S>.
+ */
+template<typename S>
+struct StaticProcessingOf
+{
+private:
+   template<typename T>
+   static typename std::is_same<typename T::StaticProcessing, T>::type test(int);
+   template<typename T>
+   static std::false_type test(...);
+
+public:
+   typedef decltype(test<S>(0)) type;
+};
+
+/**
+ * A world whose systems are known at compile time. It owns one of each of the
+ * system classes, in order, and process() runs them one after the other as
+ * direct calls instead of walking the systems of the world:
+ *
+ * StaticWorld<MovementSystem, CollisionSystem, RenderSystem> world;
+ * world.initialize();
+ * world.getSystem<RenderSystem>()->setScreen(screen);
+ *
+ * The system classes must be default constructible. The type each passes to
+ * EntitySystem is replaced by its position in the list, so there is no need
+ * for an EntitySystemType per system. Aspects can be made from constexpr
+ * masks, see componentMask() and Aspect.getAspectForMasks().
+ *
+ * Systems derived from StaticEntityProcessingSystem or
+ * StaticIntervalEntityProcessingSystem have checkProcessing(), begin(),
+ * processEntities() and end() called directly on their class, without virtual
+ * calls. Other systems are processed through those virtual hooks. Entities still
+ * reach the systems through the world as usual, and with the profiler or the
+ * performance counters enabled each system is processed the way World.process()
+ * does.
+ *
+ * Other systems can still be added with setSystem(), with a type after those
+ * of the list, but they are not processed by process().
+ */
+template<typename... Systems>
+class StaticWorld : public World
+{
+private:
+   std::tuple<Systems...> mSystems;
+
+   StaticWorld(const StaticWorld &) = delete;
+   StaticWorld & operator=(const StaticWorld &) = delete;
+
+   template<typename S>
+   static void processDirect(S &system, Bag<Entity *> *actives, std::true_type)
+   {
+      system.processStatic(actives);
+   }
+
+   static void processDirect(EntitySystem &system, Bag<Entity *> *actives, std::false_type)
+   {
+      if (!system.checkProcessing())
+         return;
+      system.begin();
+      system.processEntities(actives);
+      system.end();
+   }
+
+   template<size_t I>
+   void processStatic()
+   {
+      typedef typename std::tuple_element<I, std::tuple<Systems...> >::type System;
+      System &system = std::get<I>(mSystems);
+      EntitySystem &base = system;
+      if (base.passive)
+         return;
+      if (getProfiler() != nullptr || getPerfCounters() != nullptr) {
+         processSystem(&base);
+         return;
+      }
+      ARTEMIS_ALLOCATION_SCOPE(skSystem, I);
+      processDirect(system, &base.mActives, typename StaticProcessingOf<System>::type());
+   }
+
+   template<size_t... Is>
+   void processStatic(ViewIndices<Is...>)
+   {
+      int expand[] = { 0, (processStatic<Is>(), 0)... };
+      (void)expand;
+   }
+
+   static void runSystems(World *world)
+   {
+      static_cast<StaticWorld *>(world)->processStatic(typename MakeViewIndices<sizeof...(Systems)>::type());
+   }
+
+   template<size_t... Is>
+   void setSystems(ViewIndices<Is...>)
+   {
+      int expand[] = { 0, (addSystem(&std::get<Is>(mSystems), Is), 0)... };
+      (void)expand;
+   }
+
+   void addSystem(EntitySystem *system, EntitySystemType type)
+   {
+      system->mType = type;
+      World::setSystem(system);
+   }
+
+public:
+   StaticWorld()
+   {
+      static_assert(sizeof...(Systems) <= 64, "entities have 64 system bits");
+      setSystems(typename MakeViewIndices<sizeof...(Systems)>::type());
+   }
+
+   ~StaticWorld()
+   {
+      // The systems are members, not for the world to delete.
+      for (size_t i = 0; i < sizeof...(Systems); ++i) {
+         getSystems().set(i, nullptr);
+      }
+   }
+
+   using World::setSystem;
+   using World::getSystem;
+
+   /**
+    * Process all non-passive systems of the list, in order.
+    */
+   void process()
+   {
+      ARTEMIS_ZONE("StaticWorld::process");
+      processFrame(&StaticWorld::runSystems);
+   }
+
+   /**
+    * @return the system of a class of the list.
+    */
+   template<typename S>
+   S * getSystem()
+   {
+      return &std::get<StaticSystemIndex<S, Systems...>::value>(mSystems);
+   }
+
+   /**
+    * @return the type given to the system of a class of the list.
+    */
+   template<typename S>
+   static constexpr EntitySystemType getSystemType()
+   {
+      return StaticSystemIndex<S, Systems...>::value;
+   }
+};
+
+}
+#endif // Artemis_StaticWorld_h__
@@ -0,0 +1,121 @@
+#ifndef Artemis_View_h__
+#define Artemis_View_h__
+
+#include "artemis/Aspect.h"
+#include "artemis/ComponentManager.h"
+#include "artemis/ComponentType.h"
+#include "artemis/Entity.h"
+#include "artemis/EntityQuery.h"
+#include "artemis/World.h"
+#include "artemis/utils/Bag.h"
+#include <cstddef>
+#include <memory>
+
+namespace artemis
+{
+
+template<size_t... Is>
+struct ViewIndices {};
+
+template<size_t N, size_t... Is>
+struct MakeViewIndices : MakeViewIndices<N - 1, N - 1, Is...> {};
+
+template<size_t... Is>
+struct MakeViewIndices<0, Is...>
+{
+   typedef ViewIndices<Is...> type;
+};
+
+/**
+ * Iterates the entities having all of some component classes and hands their
+ * components to a function by reference:
+ *
+ * auto movers = world.view<Position, Velocity>();
+ * movers.each([](Position &p, Velocity &v) { p.x += v.x; });
+ *
+ * The component types come from ComponentTypeOf at compile time and the storage
+ * of each is looked up once, when the view is made, so the loop body is the
+ * function itself, inlined, with no virtual call or mapper per entity.
+ *
+ * The entities come from a World.query() that the view keeps alive, so keep the
+ * view rather than making a new one every frame. Systems can also walk their own
+ * actives with each(entities, f).
+ */
+template<typename... Ts>
+class View
+{
+private:
+   std::shared_ptr<EntityQuery> mQuery;
+   const Bag<Component *> *mStorage[sizeof...(Ts)];
+
+   template<typename F, size_t... Is>
+   static void each(const Bag<Component *> *const *storage, const Bag<Entity *> &entities, F &f, ViewIndices<Is...>)
+   {
+      for (size_t i = 0; i < entities.size(); ++i) {
+         int id = entities.get(i)->getId();
+         f(*static_cast<Ts *>(storage[Is]->get(id))...);
+      }
+   }
+
+   template<typename F, size_t... Is>
+   static void eachWithEntity(const Bag<Component *> *const *storage, const Bag<Entity *> &entities, F &f, ViewIndices<Is...>)
+   {
+      for (size_t i = 0; i < entities.size(); ++i) {
+         Entity *e = entities.get(i);
+         int id = e->getId();
+         f(e, *static_cast<Ts *>(storage[Is]->get(id))...);
+      }
+   }
+
+public:
+   View(World *world)
+   {
+      static_assert(sizeof...(Ts) > 0, "a view needs at least one component class");
+      mQuery = world->query(Aspect::getAspectForAll(ComponentTypeOf<Ts>::value...));
+      ComponentType types[] = { ComponentTypeOf<Ts>::value... };
+      for (size_t i = 0; i < sizeof...(Ts); ++i) {
+         mStorage[i] = world->getComponentManager()->getComponentsByType(types[i]);
+      }
+   }
+
+   /**
+    * Calls f(Ts &...) for every entity of the view.
+    */
+   template<typename F>
+   void each(F f) const
+   {
+      each(mStorage, mQuery->getEntities(), f, typename MakeViewIndices<sizeof...(Ts)>::type());
+   }
+
+   /**
+    * Calls f(Entity *, Ts &...) for every entity of the view.
+    */
+   template<typename F>
+   void eachWithEntity(F f) const
+   {
+      eachWithEntity(mStorage, mQuery->getEntities(), f, typename MakeViewIndices<sizeof...(Ts)>::type());
+   }
+
+   /**
+    * Calls f(Ts &...) for given entities, which must all have the components,
+    * e.g. the actives of a system with a matching aspect.
+    */
+   template<typename F>
+   void each(const Bag<Entity *> &entities, F f) const
+   {
+      each(mStorage, entities, f, typename MakeViewIndices<sizeof...(Ts)>::type());
+   }
+
+   size_t size() const { return mQuery->size(); }
+
+   const std::shared_ptr<EntityQuery> & getQuery() const { return mQuery; }
+};
+
+template<typename... Ts>
+View<Ts...> World::view()
+{
+   return View<Ts...>(this);
+}
+
+}
+#endif // Artemis_View_h__
@@ -1,13 +1,30 @@
 #include "artemis/World.h"
+#include "artemis/Aspect.h"
 #include "artemis/Manager.h"
 #include "artemis/ComponentManager.h"
 #include "artemis/EntityManager.h"
 #include "artemis/EntitySystem.h"
+#include "artemis/Entity.h"
+#include "artemis/EntityQuery.h"
+#include "artemis/Prefab.h"
+#include "artemis/utils/AllocationTracker.h"
+#include "artemis/utils/EntityFile.h"
+#include "artemis/utils/FrameProfiler.h"
+#include "artemis/utils/Instrumentation.h"
+#include "artemis/utils/MappedFile.h"
+#include "artemis/utils/PerfCounters.h"
+#include "artemis/utils/StreamingLoader.h"
+#include "artemis/utils/WorldInspector.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
 
 namespace artemis
 {
 
-World::World()
+World::World(): delta(0.f), mCleanBudget(0), mFrame(0), mProfiler(nullptr), mPerfCounters(nullptr), mChurnCounters(nullptr), mInspector(nullptr), mJournal(nullptr), mLoader(nullptr), mProcessing(false)
 {
    mCM = new ComponentManager();
    setManager<ComponentManager>(mCM);
@@ -18,6 +35,17 @@ World::World()
 
 World::~World()
 {
+   for (size_t i = 0; i < mBulkOperations.size(); ++i) {
+      delete mBulkOperations[i].aspect;
+      delete mBulkOperations[i].prototype;
+   }
+   // Queries may outlive the world, they stop being updated.
+   for (size_t i = 0; i < mQueries.size(); ++i) {
+      mQueries[i]->world = nullptr;
+   }
+   delete mInspector;
+   delete mLoader;
+   delete mJournal;
    //deleteManager(mCM);
    //deleteManager(mEM);
    for (size_t i = 0; i < managersBag.size(); ++i) {
@@ -32,23 +60,528 @@ World::~World()
          deleteSystem(s);
    }
    systemsBag.clear();
+   delete mProfiler;
+   delete mPerfCounters;
+   delete mChurnCounters;
 }
 
 void World::initialize()
 {
    for (size_t i = 0; i < managersBag.size(); ++i) {
-      managersBag.get(i)->initialize();
+      if (managersBag.get(i))
+         managersBag.get(i)->initialize();
    }
 
    for (size_t i = 0; i < systemsBag.size(); ++i) {
       EntitySystem *system = systemsBag.get(i);
+      if (!system)
+         continue;
       auto v = system->getMappers();
       for (size_t m_i = 0; m_i < v->size(); ++m_i) {
          v->get(m_i)->init(this);
       }
-      if (system)
-         systemsBag.get(i)->initialize();
+      system->initialize();
+   }
+}
+
+void World::reserve(size_t entities, const std::map<ComponentType, size_t> &perComponentHints)
+{
+   mEM->reserve(entities);
+   mCM->reserve(entities, perComponentHints);
+
+   mAddedEntities.reserve(entities);
+   mChangedEntities.reserve(entities);
+   mDeletedEntities.reserve(entities);
+   mEnabledEntities.reserve(entities);
+   mDisabledEntities.reserve(entities);
+
+   for (size_t i = 0; i < systemsBag.size(); ++i) {
+      if (systemsBag.get(i))
+         systemsBag.get(i)->reserve(entities);
+   }
+}
+
+void World::setIncrementalGrowth(bool incremental)
+{
+   mEM->setIncrementalGrowth(incremental);
+   mCM->setIncrementalGrowth(incremental);
+
+   mAddedEntities.setIncrementalGrowth(incremental);
+   mChangedEntities.setIncrementalGrowth(incremental);
+   mDeletedEntities.setIncrementalGrowth(incremental);
+   mEnabledEntities.setIncrementalGrowth(incremental);
+   mDisabledEntities.setIncrementalGrowth(incremental);
+
+   for (size_t i = 0; i < systemsBag.size(); ++i) {
+      if (systemsBag.get(i))
+         systemsBag.get(i)->setIncrementalGrowth(incremental);
+   }
+}
+
+FrameProfiler * World::enableProfiler(size_t frames)
+{
+   delete mProfiler;
+   mProfiler = new FrameProfiler(frames);
+   return mProfiler;
+}
+
+void World::disableProfiler()
+{
+   delete mProfiler;
+   mProfiler = nullptr;
+}
+
+PerfCounters * World::enablePerfCounters()
+{
+   delete mPerfCounters;
+   mPerfCounters = new PerfCounters();
+   return mPerfCounters;
+}
+
+void World::disablePerfCounters()
+{
+   delete mPerfCounters;
+   mPerfCounters = nullptr;
+}
+
+ChurnCounters * World::enableChurnCounters()
+{
+   delete mChurnCounters;
+   mChurnCounters = new ChurnCounters();
+   setBagGrowthCounter(mChurnCounters->getBagGrowthCounter());
+   return mChurnCounters;
+}
+
+void World::disableChurnCounters()
+{
+   setBagGrowthCounter(nullptr);
+   delete mChurnCounters;
+   mChurnCounters = nullptr;
+}
+
+void World::setBagGrowthCounter(uint64_t *growths)
+{
+   mEM->setGrowthCounter(growths);
+   mCM->setGrowthCounter(growths);
+
+   mAddedEntities.setGrowthCounter(growths);
+   mChangedEntities.setGrowthCounter(growths);
+   mDeletedEntities.setGrowthCounter(growths);
+   mEnabledEntities.setGrowthCounter(growths);
+   mDisabledEntities.setGrowthCounter(growths);
+
+   for (size_t i = 0; i < systemsBag.size(); ++i) {
+      if (systemsBag.get(i))
+         systemsBag.get(i)->setGrowthCounter(growths);
+   }
+}
+
+std::vector<ChurnCounters::Archetype> World::takeArchetypeCensus()
+{
+   std::unordered_map<std::bitset<64>, size_t> populations;
+   Bag<Entity *> &entities = mEM->mEntities;
+   for (size_t i = 0; i < entities.size(); ++i) {
+      if (entities.get(i) != nullptr) {
+         populations[entities.get(i)->getComponentBits()]++;
+      }
+   }
+
+   std::vector<ChurnCounters::Archetype> census;
+   census.reserve(populations.size());
+   for (auto it = populations.begin(); it != populations.end(); ++it) {
+      ChurnCounters::Archetype archetype;
+      archetype.componentBits = it->first;
+      archetype.population = it->second;
+      census.push_back(archetype);
+   }
+   std::sort(census.begin(), census.end(), [](const ChurnCounters::Archetype &a, const ChurnCounters::Archetype &b) {
+      return a.population > b.population;
+   });
+   return census;
+}
+
+MemoryReport World::memoryReport()
+{
+   MemoryReport report;
+   mCM->reportComponents(report);
+   mEM->reportEntities(report);
+
+   for (size_t i = 0; i < managersBag.size() && i < MemoryReport::MAX_TYPES; ++i) {
+      if (managersBag.get(i))
+         managersBag.get(i)->reportMemory(report.managers[i]);
+   }
+   for (size_t i = 0; i < systemsBag.size() && i < MemoryReport::MAX_TYPES; ++i) {
+      if (systemsBag.get(i))
+         systemsBag.get(i)->reportMemory(report.systems[i]);
+   }
+
+   for (int i = 0; i < 2; ++i) {
+      report.world.add(mFrameArenas[i].getUsed(), mFrameArenas[i].getCapacity());
+   }
+   for (size_t i = 0; i < mQueries.size(); ++i) {
+      mQueries[i]->reportMemory(report.world);
+   }
+   report.world.add(managersBag.getUsedBytes(), managersBag.getReservedBytes());
+   report.world.add(systemsBag.getUsedBytes(), systemsBag.getReservedBytes());
+   return report;
+}
+
+WorldInspector * World::startInspector(const std::string &path)
+{
+   stopInspector();
+   mInspector = new WorldInspector(this, path);
+   if (!mInspector->start()) {
+      delete mInspector;
+      mInspector = nullptr;
+   }
+   return mInspector;
+}
+
+void World::stopInspector()
+{
+   delete mInspector;
+   mInspector = nullptr;
+}
+
+void World::setComponentCodec(ComponentType type, const ComponentCodec &codec, size_t size)
+{
+   mCM->setComponentCodec(type, codec);
+   mCM->setComponentSize(type, size);
+}
+
+namespace
+{
+
+/*
+ * Snapshot file layout, in native byte order, every section 8-byte aligned:
+ * header, an EntityRecord per entity, the free ids of the identifier pool, then per
+ * component type a TypeRecord followed by the data of each of its components in
+ * the order of the entity records.
+ */
+const char SNAPSHOT_MAGIC[8] = { 'A', 'R', 'T', 'S', 'N', 'A', 'P', 0 };
+const uint32_t SNAPSHOT_VERSION = 1;
+
+struct SnapshotHeader
+{
+   char magic[8];
+   uint32_t version;
+   uint32_t typeCount;
+   uint64_t entityCount;
+   uint64_t freeIdCount;
+   uint32_t nextAvailableId;
+   uint32_t padding;
+};
+
+struct EntityRecord
+{
+   int32_t id;
+   uint32_t disabled;
+   uint64_t componentBits;
+};
+
+struct TypeRecord
+{
+   uint32_t type;
+   uint32_t dataSize;
+   uint64_t count;
+};
+
+size_t align8(size_t n)
+{
+   return (n + 7) & ~size_t(7);
+}
+
+}
+
+bool World::saveSnapshot(const std::string &path)
+{
+   std::vector<Entity *> entities;
+   entities.reserve(mEM->mActiveCnt + mAddedEntities.size() + mInstantiatedEntities.size());
+   Bag<Entity *> &active = mEM->mEntities;
+   for (size_t i = 0; i < active.size(); ++i) {
+      if (active.get(i) != nullptr)
+         entities.push_back(active.get(i));
+   }
+   std::vector<bool> queued;
+   for (size_t i = 0; i < mAddedEntities.size(); ++i) {
+      Entity *e = mAddedEntities.get(i);
+      size_t id = e->getId();
+      if (id >= queued.size())
+         queued.resize(id + 1, false);
+      if (mEM->getEntity(e->getId()) != e && !queued[id]) {
+         queued[id] = true;
+         entities.push_back(e);
+      }
+   }
+   entities.insert(entities.end(), mInstantiatedEntities.begin(), mInstantiatedEntities.end());
+
+   // Components of a type without a codec are left out, along with their bits.
+   std::bitset<64> savedTypes;
+   size_t counts[64] = {};
+   for (size_t t = 0; t < 64; ++t) {
+      if (mCM->getComponentCodec(t) != nullptr)
+         savedTypes.set(t);
+   }
+   for (size_t i = 0; i < entities.size(); ++i) {
+      std::bitset<64> bits = entities[i]->getComponentBits() & savedTypes;
+      for (size_t t = 0; t < 64; ++t) {
+         if (bits.test(t))
+            counts[t]++;
+      }
+   }
+
+   // Ids of deleted entities not reclaimed yet are free once restored.
+   const std::vector<unsigned int> &freeIds = mEM->identifierPool.getFreeIds();
+   size_t freeIdCount = freeIds.size() + mEM->mDeletedEntities.size();
+
+   size_t size = sizeof(SnapshotHeader) + entities.size() * sizeof(EntityRecord) + align8(freeIdCount * sizeof(uint32_t));
+   uint32_t typeCount = 0;
+   for (size_t t = 0; t < 64; ++t) {
+      if (counts[t] > 0) {
+         size += sizeof(TypeRecord) + align8(counts[t] * mCM->getComponentCodec(t)->size);
+         typeCount++;
+      }
+   }
+
+   std::string temporary = path + ".tmp";
+   MappedFile file;
+   if (!file.openWrite(temporary, size))
+      return false;
+
+   char *out = file.data();
+   SnapshotHeader *header = reinterpret_cast<SnapshotHeader *>(out);
+   std::memset(header, 0, sizeof(SnapshotHeader));
+   std::memcpy(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+   header->version = SNAPSHOT_VERSION;
+   header->typeCount = typeCount;
+   header->entityCount = entities.size();
+   header->freeIdCount = freeIdCount;
+   header->nextAvailableId = mEM->identifierPool.getNextAvailableId();
+   out += sizeof(SnapshotHeader);
+
+   EntityRecord *records = reinterpret_cast<EntityRecord *>(out);
+   for (size_t i = 0; i < entities.size(); ++i) {
+      records[i].id = entities[i]->getId();
+      records[i].disabled = mEM->isEnabled(entities[i]->getId()) ? 0 : 1;
+      records[i].componentBits = (entities[i]->getComponentBits() & savedTypes).to_ullong();
+   }
+   out += entities.size() * sizeof(EntityRecord);
+
+   uint32_t *ids = reinterpret_cast<uint32_t *>(out);
+   if (!freeIds.empty())
+      std::memcpy(ids, freeIds.data(), freeIds.size() * sizeof(uint32_t));
+   for (size_t i = 0; i < mEM->mDeletedEntities.size(); ++i) {
+      ids[freeIds.size() + i] = mEM->mDeletedEntities.get(i)->getId();
+   }
+   out += align8(freeIdCount * sizeof(uint32_t));
+
+   for (size_t t = 0; t < 64; ++t) {
+      if (counts[t] == 0)
+         continue;
+      const ComponentCodec *codec = mCM->getComponentCodec(t);
+      TypeRecord *type = reinterpret_cast<TypeRecord *>(out);
+      type->type = static_cast<uint32_t>(t);
+      type->dataSize = static_cast<uint32_t>(codec->size);
+      type->count = counts[t];
+      out += sizeof(TypeRecord);
+
+      Bag<Component *> *components = mCM->getComponentsByType(t);
+      char *data = out;
+      for (size_t i = 0; i < entities.size(); ++i) {
+         if (records[i].componentBits & (uint64_t(1) << t)) {
+            codec->save(components->get(entities[i]->getId()), data);
+            data += codec->size;
+         }
+      }
+      out += align8(counts[t] * codec->size);
+   }
+
+   bool written = file.sync();
+   file.close();
+   if (!written || std::rename(temporary.c_str(), path.c_str()) != 0) {
+      std::remove(temporary.c_str());
+      return false;
+   }
+   return true;
+}
+
+bool World::loadSnapshot(const std::string &path)
+{
+   if (mEM->identifierPool.getNextAvailableId() != 0 || !mAddedEntities.isEmpty())
+      return false;
+
+   MappedFile file;
+   if (!file.openRead(path) || file.size() < sizeof(SnapshotHeader))
+      return false;
+
+   const char *in = file.data();
+   const char *end = in + file.size();
+   const SnapshotHeader *header = reinterpret_cast<const SnapshotHeader *>(in);
+   if (std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0 || header->version != SNAPSHOT_VERSION)
+      return false;
+   in += sizeof(SnapshotHeader);
+
+   // Check every section against the file and the registered codecs before touching the world.
+   if (header->entityCount > size_t(end - in) / sizeof(EntityRecord))
+      return false;
+   const EntityRecord *records = reinterpret_cast<const EntityRecord *>(in);
+   in += header->entityCount * sizeof(EntityRecord);
+   if (header->freeIdCount > size_t(end - in) / sizeof(uint32_t))
+      return false;
+   const uint32_t *freeIds = reinterpret_cast<const uint32_t *>(in);
+   in += align8(header->freeIdCount * sizeof(uint32_t));
+
+   int maxId = -1;
+   uint64_t counts[64] = {};
+   for (size_t i = 0; i < header->entityCount; ++i) {
+      if (records[i].id < 0 || static_cast<uint32_t>(records[i].id) >= header->nextAvailableId)
+         return false;
+      maxId = std::max(maxId, records[i].id);
+      for (size_t t = 0; t < 64; ++t) {
+         if (records[i].componentBits & (uint64_t(1) << t))
+            counts[t]++;
+      }
+   }
+
+   // Each id is either live or free, once, and below the next id to hand out.
+   size_t idCount = maxId + 1;
+   for (size_t i = 0; i < header->freeIdCount; ++i) {
+      if (freeIds[i] >= header->nextAvailableId)
+         return false;
+      idCount = std::max(idCount, size_t(freeIds[i]) + 1);
+   }
+   std::vector<bool> seen(idCount, false);
+   for (size_t i = 0; i < header->entityCount; ++i) {
+      if (seen[records[i].id])
+         return false;
+      seen[records[i].id] = true;
+   }
+   for (size_t i = 0; i < header->freeIdCount; ++i) {
+      if (seen[freeIds[i]])
+         return false;
+      seen[freeIds[i]] = true;
+   }
+
+   const char *typeSections = in;
+   for (uint32_t i = 0; i < header->typeCount; ++i) {
+      if (in > end || size_t(end - in) < sizeof(TypeRecord))
+         return false;
+      const TypeRecord *type = reinterpret_cast<const TypeRecord *>(in);
+      const ComponentCodec *codec = type->type < 64 ? mCM->getComponentCodec(type->type) : nullptr;
+      if (codec == nullptr || codec->size != type->dataSize || counts[type->type] != type->count)
+         return false;
+      counts[type->type] = 0;
+      in += sizeof(TypeRecord);
+      if (type->dataSize > 0 && type->count > size_t(end - in) / type->dataSize)
+         return false;
+      in += align8(type->count * type->dataSize);
+   }
+   for (size_t t = 0; t < 64; ++t) {
+      if (counts[t] != 0)
+         return false; // component bits without a section
+   }
+
+   mEM->identifierPool.restore(header->nextAvailableId, freeIds, header->freeIdCount);
+
+   std::vector<Entity *> entities(header->entityCount);
+   mEM->mEntities.ensureCapacity(maxId + 1);
+   mAddedEntities.reserve(header->entityCount);
+   for (size_t i = 0; i < header->entityCount; ++i) {
+      Entity *e = mEM->createEntityInstance(records[i].id);
+      e->getComponentBits() = std::bitset<64>(records[i].componentBits);
+      entities[i] = e;
+   }
+
+   in = typeSections;
+   for (uint32_t i = 0; i < header->typeCount; ++i) {
+      const TypeRecord *type = reinterpret_cast<const TypeRecord *>(in);
+      const ComponentCodec *codec = mCM->getComponentCodec(type->type);
+      in += sizeof(TypeRecord);
+
+      Bag<Component *> *components = mCM->getComponentsByType(type->type);
+      components->ensureCapacity(maxId + 1);
+      const char *data = in;
+      uint64_t bit = uint64_t(1) << type->type;
+      for (size_t j = 0; j < header->entityCount; ++j) {
+         if (records[j].componentBits & bit) {
+            Component *component = codec->create();
+            codec->load(component, data);
+            components->set(records[j].id, component);
+            data += type->dataSize;
+         }
+      }
+      in += align8(type->count * type->dataSize);
+   }
+
+   for (size_t i = 0; i < entities.size(); ++i) {
+      addEntity(entities[i]);
+      if (records[i].disabled)
+         disable(entities[i]);
    }
+   return true;
+}
+
+CommandJournal * World::enableJournal(const std::string &path, size_t capacity)
+{
+   disableJournal();
+   CommandJournal *journal = new CommandJournal(this);
+   if (!journal->open(path, capacity)) {
+      delete journal;
+      return nullptr;
+   }
+   mJournal = journal;
+   return mJournal;
+}
+
+void World::disableJournal()
+{
+   delete mJournal;
+   mJournal = nullptr;
+}
+
+bool World::evict(Entity *const *entities, size_t count, const std::string &path)
+{
+   ARTEMIS_ZONE("World::evict");
+   if (!EntityFile::write(this, entities, count, path))
+      return false;
+
+   // Queue the deletions at once, deleteEntity() checks the pending ones each time.
+   std::vector<bool> pending;
+   for (size_t i = 0; i < mDeletedEntities.size(); ++i) {
+      size_t id = mDeletedEntities.get(i)->getId();
+      if (id >= pending.size())
+         pending.resize(id + 1, false);
+      pending[id] = true;
+   }
+   mDeletedEntities.reserve(mDeletedEntities.size() + count);
+   for (size_t i = 0; i < count; ++i) {
+      size_t id = entities[i]->getId();
+      if (id < pending.size() && pending[id])
+         continue;
+      mDeletedEntities.add(entities[i]);
+      if (mJournal)
+         mJournal->record(CommandJournal::cmDeleteFromWorld, entities[i]);
+   }
+   return true;
+}
+
+bool World::rehydrate(const std::string &path, std::vector<Entity *> *created)
+{
+   ARTEMIS_ZONE("World::rehydrate");
+   return EntityFile::read(this, path, created);
+}
+
+StreamingLoader * World::enableStreamingLoader(size_t budget, size_t buffers)
+{
+   disableStreamingLoader();
+   mLoader = new StreamingLoader(this, budget, buffers);
+   return mLoader;
+}
+
+void World::disableStreamingLoader()
+{
+   delete mLoader;
+   mLoader = nullptr;
 }
 
 void World::deleteManager(Manager *manager)
@@ -59,7 +592,189 @@ void World::deleteManager(Manager *manager)
 
 Entity * World::createEntity()
 {
-   return mEM->createEntityInstance();
+   Entity *e = mEM->createEntityInstance();
+   if (mJournal)
+      mJournal->record(CommandJournal::cmCreateEntity, e);
+   return e;
+}
+
+void World::createEntities(Entity **out, size_t count)
+{
+   mEM->createEntityInstances(out, count);
+   if (mJournal) {
+      for (size_t i = 0; i < count; ++i) {
+         mJournal->record(CommandJournal::cmCreateEntity, out[i]);
+      }
+   }
+}
+
+void World::instantiate(const Prefab *prefab, size_t count, Entity **out)
+{
+   if (count == 0)
+      return;
+   ARTEMIS_ZONE("World::instantiate");
+
+   size_t first = mInstantiatedEntities.size();
+   mInstantiatedEntities.resize(first + count);
+   Entity **entities = &mInstantiatedEntities[first];
+   createEntities(entities, count);
+   int last = entities[count - 1]->getId();
+
+   for (size_t c = 0; c < prefab->getComponentCount(); ++c) {
+      Bag<Component *> *components = mCM->getComponentsByType(prefab->getComponentType(c));
+      components->ensureCapacity(last);
+      for (size_t i = 0; i < count; ++i) {
+         components->set(entities[i]->getId(), prefab->createComponent(c));
+      }
+      if (mChurnCounters)
+         mChurnCounters->componentsAdded(prefab->getComponentType(c), count);
+   }
+
+   const std::bitset<64> &bits = prefab->getComponentBits();
+   for (size_t i = 0; i < count; ++i) {
+      entities[i]->getComponentBits() = bits;
+   }
+   if (mJournal) {
+      for (size_t i = 0; i < count; ++i) {
+         Entity *e = entities[i];
+         for (size_t c = 0; c < prefab->getComponentCount(); ++c) {
+            mJournal->recordComponent(e, mCM->getComponentsByType(prefab->getComponentType(c))->get(e->getId()));
+         }
+         mJournal->record(CommandJournal::cmAddToWorld, e);
+      }
+   }
+
+   InstantiatedBatch batch;
+   batch.componentBits = bits;
+   batch.first = first;
+   batch.count = count;
+   mInstantiatedBatches.push_back(batch);
+
+   if (out != nullptr)
+      std::copy(entities, entities + count, out);
+}
+
+std::shared_ptr<EntityQuery> World::query(Aspect *aspect)
+{
+   for (size_t i = 0; i < mQueries.size(); ++i) {
+      if (*mQueries[i]->mAspect == *aspect) {
+         delete aspect;
+         return mQueries[i]->shared_from_this();
+      }
+   }
+
+   std::shared_ptr<EntityQuery> query(new EntityQuery(this, aspect));
+   Bag<Entity *> &active = mEM->mEntities;
+   for (size_t i = 0; i < active.size(); ++i) {
+      if (active.get(i) != nullptr)
+         query->check(active.get(i));
+   }
+   mQueries.push_back(query.get());
+   return query;
+}
+
+void World::removeQuery(EntityQuery *query)
+{
+   mQueries.erase(std::remove(mQueries.begin(), mQueries.end(), query), mQueries.end());
+}
+
+void World::deleteAll(Aspect *aspect)
+{
+   queueBulkOperation(CommandJournal::cmDeleteAll, aspect, 0, nullptr, nullptr);
+}
+
+void World::removeComponentFromAll(Aspect *aspect, ComponentType type)
+{
+   queueBulkOperation(CommandJournal::cmRemoveComponentFromAll, aspect, type, nullptr, nullptr);
+}
+
+void World::disableAll(Aspect *aspect)
+{
+   queueBulkOperation(CommandJournal::cmDisableAll, aspect, 0, nullptr, nullptr);
+}
+
+void World::queueBulkOperation(int command, Aspect *aspect, ComponentType type, Component *prototype, Component * (*copy)(const Component *))
+{
+   BulkOperation operation;
+   operation.command = command;
+   operation.aspect = aspect;
+   operation.type = type;
+   operation.prototype = prototype;
+   operation.copy = copy;
+   mBulkOperations.push_back(operation);
+   if (mJournal)
+      mJournal->recordBulkOperation(command, aspect, type, prototype);
+}
+
+void World::applyBulkOperation(const BulkOperation &operation)
+{
+   std::vector<Entity *> entities;
+   Bag<Entity *> &active = mEM->mEntities;
+   for (size_t i = 0; i < active.size(); ++i) {
+      Entity *e = active.get(i);
+      if (e == nullptr || !operation.aspect->matches(e->getComponentBits()))
+         continue;
+      if (operation.command == CommandJournal::cmDisableAll && !mEM->isEnabled(e->getId()))
+         continue;
+      entities.push_back(e);
+   }
+   if (entities.empty())
+      return;
+
+   void (EntityObserver::* func)(Entity *) = &EntityObserver::changed;
+   if (operation.command == CommandJournal::cmDeleteAll) {
+      func = &EntityObserver::deleted;
+   }
+   else if (operation.command == CommandJournal::cmDisableAll) {
+      func = &EntityObserver::disabled;
+   }
+   else if (operation.command == CommandJournal::cmAddComponentToAll) {
+      const ComponentCodec *codec = operation.copy == nullptr ? mCM->getComponentCodec(operation.type) : nullptr;
+      for (size_t i = 0; i < entities.size(); ++i) {
+         mCM->addComponent(entities[i], codec != nullptr ? codec->copy(operation.prototype) : operation.copy(operation.prototype));
+      }
+   }
+   else {
+      for (size_t i = 0; i < entities.size(); ++i) {
+         mCM->removeComponent(entities[i], operation.type);
+      }
+   }
+
+   for (size_t m = 0; m < managersBag.size(); ++m) {
+      Manager *manager = managersBag.get(m);
+      if (manager) {
+         ARTEMIS_ALLOCATION_SCOPE(skManager, m);
+         for (size_t i = 0; i < entities.size(); ++i) {
+            (manager->*func)(entities[i]);
+         }
+      }
+   }
+
+   for (size_t q = 0; q < mQueries.size(); ++q) {
+      for (size_t i = 0; i < entities.size(); ++i) {
+         (mQueries[q]->*func)(entities[i]);
+      }
+   }
+
+   // Disabled entities stay out of systems until they are enabled.
+   if (func == &EntityObserver::changed) {
+      size_t enabled = 0;
+      for (size_t i = 0; i < entities.size(); ++i) {
+         if (mEM->isEnabled(entities[i]->getId()))
+            entities[enabled++] = entities[i];
+      }
+      entities.resize(enabled);
+   }
+   for (size_t s = 0; s < systemsBag.size(); ++s) {
+      EntitySystem *system = systemsBag.get(s);
+      if (system) {
+         ARTEMIS_ALLOCATION_SCOPE(skSystem, s);
+         if (func == &EntityObserver::changed)
+            system->check(entities.data(), entities.size());
+         else
+            system->removeFromSystem(entities.data(), entities.size());
+      }
+   }
 }
 
 Entity * World::getEntity( int entityId )
@@ -77,8 +792,10 @@ void World::notifySystems(void (EntityObserver::* func)(Entity *), Entity *e)
 {
    size_t s = systemsBag.size();
    for (size_t i = 0; i < s; ++i) {
-      if (systemsBag.get(i))
+      if (systemsBag.get(i)) {
+         ARTEMIS_ALLOCATION_SCOPE(skSystem, i);
          (systemsBag.get(i)->*func)(e);
+      }
    }
 }
 
@@ -86,41 +803,198 @@ void World::notifyManagers(void (EntityObserver::* func)(Entity *), Entity *e)
 {
    size_t s = managersBag.size();
    for (size_t i = 0; i < s; ++i) {
-      if (managersBag.get(i))
+      if (managersBag.get(i)) {
+         ARTEMIS_ALLOCATION_SCOPE(skManager, i);
          (managersBag.get(i)->*func)(e);
+      }
+   }
+}
+
+void World::notifyQueries(void (EntityObserver::* func)(Entity *), Entity *e)
+{
+   for (size_t i = 0; i < mQueries.size(); ++i) {
+      (mQueries[i]->*func)(e);
    }
 }
 
 void World::check(Bag<Entity *> *entities, void (EntityObserver::* func)(Entity *))
 {
    if (!entities->isEmpty()) {
+      ARTEMIS_ZONE("World::check");
       for (size_t i = 0; i < entities->size(); ++i) {
          Entity *e = entities->get(i);
          notifyManagers(func, e);
          notifySystems(func, e);
+         notifyQueries(func, e);
       }
       entities->clear();
    }
 }
 
+void World::checkInstantiated()
+{
+   if (mInstantiatedBatches.empty())
+      return;
+   ARTEMIS_ZONE("World::checkInstantiated");
+
+   // Observers may instantiate more, those wait for the next process().
+   std::vector<Entity *> entities;
+   std::vector<InstantiatedBatch> batches;
+   entities.swap(mInstantiatedEntities);
+   batches.swap(mInstantiatedBatches);
+
+   for (size_t b = 0; b < batches.size(); ++b) {
+      Entity **batch = &entities[batches[b].first];
+      size_t count = batches[b].count;
+      for (size_t m = 0; m < managersBag.size(); ++m) {
+         Manager *manager = managersBag.get(m);
+         if (manager) {
+            ARTEMIS_ALLOCATION_SCOPE(skManager, m);
+            for (size_t i = 0; i < count; ++i) {
+               manager->added(batch[i]);
+            }
+         }
+      }
+      for (size_t s = 0; s < systemsBag.size(); ++s) {
+         EntitySystem *system = systemsBag.get(s);
+         if (system && system->isInterested(batches[b].componentBits)) {
+            ARTEMIS_ALLOCATION_SCOPE(skSystem, s);
+            system->insertToSystem(batch, count);
+         }
+      }
+      for (size_t q = 0; q < mQueries.size(); ++q) {
+         if (mQueries[q]->mAspect->matches(batches[b].componentBits)) {
+            for (size_t i = 0; i < count; ++i) {
+               mQueries[q]->check(batch[i]);
+            }
+         }
+      }
+   }
+
+   // Keep the storage for the next batches.
+   entities.clear();
+   batches.clear();
+   if (mInstantiatedEntities.empty()) {
+      mInstantiatedEntities.swap(entities);
+      mInstantiatedBatches.swap(batches);
+   }
+}
+
+void World::checkBulkOperations()
+{
+   if (mBulkOperations.empty())
+      return;
+   ARTEMIS_ZONE("World::checkBulkOperations");
+
+   // Operations queued by observers meanwhile wait for the next process().
+   std::vector<BulkOperation> operations;
+   operations.swap(mBulkOperations);
+   for (size_t i = 0; i < operations.size(); ++i) {
+      applyBulkOperation(operations[i]);
+      delete operations[i].aspect;
+      delete operations[i].prototype;
+   }
+}
+
 void World::process()
 {
+   ARTEMIS_ZONE("World::process");
+   processFrame(&World::processSystems);
+}
+
+void World::processSystems(World *world)
+{
+   Bag<EntitySystem *> &systems = world->systemsBag;
+   size_t s = systems.size();
+   for (size_t i = 0; i < s; ++i) {
+      EntitySystem *system = systems.get(i);
+      if (system && !system->isPassive()) {
+         world->processSystem(system);
+      }
+   }
+}
+
+void World::processSystem(EntitySystem *system)
+{
+   ARTEMIS_ALLOCATION_SCOPE(skSystem, system->getType());
+   PerfCounters *counters = mPerfCounters != nullptr && mPerfCounters->isAvailable() ? mPerfCounters : nullptr;
+   if (counters) {
+      PerfCounters::Sample before, after;
+      bool sampled = counters->read(before);
+      system->process();
+      // A failed read leaves its sample undefined, the frame is not recorded then.
+      if (counters->read(after) && sampled)
+         counters->record(system->getType(), before, after);
+   }
+   else {
+      system->process();
+   }
+}
+
+void World::processFrame(void (*runSystems)(World *))
+{
+   ARTEMIS_ALLOCATION_FRAME();
+
+   // Loaded entities are journaled as if added before this frame.
+   if (mLoader)
+      mLoader->commit();
+   if (mJournal)
+      mJournal->recordProcess();
+   mProcessing = true;
+
+   FrameProfiler *profiler = mProfiler;
+   if (profiler)
+      profiler->beginFrame();
+
    check(&mAddedEntities, &EntityObserver::added);
+   checkInstantiated();
+   if (profiler)
+      profiler->endPhase(FrameProfiler::ppCheckAdded);
    check(&mChangedEntities, &EntityObserver::changed);
+   if (profiler)
+      profiler->endPhase(FrameProfiler::ppCheckChanged);
    check(&mDisabledEntities, &EntityObserver::disabled);
+   if (profiler)
+      profiler->endPhase(FrameProfiler::ppCheckDisabled);
    check(&mEnabledEntities, &EntityObserver::enabled);
+   if (profiler)
+      profiler->endPhase(FrameProfiler::ppCheckEnabled);
    check(&mDeletedEntities, &EntityObserver::deleted);
+   if (profiler)
+      profiler->endPhase(FrameProfiler::ppCheckDeleted);
+   checkBulkOperations();
+   if (profiler)
+      profiler->endPhase(FrameProfiler::ppBulkOperations);
 
-   mCM->clean();
-   mEM->clean();
-
-   size_t s = systemsBag.size();
-   for (size_t i = 0; i < s; ++i) {
-      EntitySystem *system = systemsBag.get(i);
-      if (system && !system->isPassive()) {
-         system->process();
-      }
+   {
+      ARTEMIS_ALLOCATION_SCOPE(skManager, mtComponentManager);
+      mCM->clean(mCleanBudget);
+   }
+   if (profiler)
+      profiler->endPhase(FrameProfiler::ppComponentClean);
+   {
+      ARTEMIS_ALLOCATION_SCOPE(skManager, mtEntityManager);
+      mEM->clean();
    }
+   if (profiler)
+      profiler->endPhase(FrameProfiler::ppEntityClean);
+
+   PerfCounters *counters = mPerfCounters != nullptr && mPerfCounters->isAvailable() ? mPerfCounters : nullptr;
+   if (counters)
+      counters->beginFrame();
+
+   runSystems(this);
+
+   if (profiler)
+      profiler->endFrame();
+   if (mChurnCounters)
+      mChurnCounters->endFrame();
+   if (mInspector)
+      mInspector->update();
+
+   mFrame = 1 - mFrame;
+   mFrameArenas[mFrame].reset();
+   mProcessing = false;
 }
 
 }
@@ -6,16 +6,33 @@
 #include "artemis/ComponentType.h"
 #include "artemis/utils/Bag.h"
 #include "artemis/ComponentMapper.h"
+#include "artemis/ComponentCodec.h"
+#include "artemis/utils/FrameArena.h"
+#include "artemis/utils/ChurnCounters.h"
+#include "artemis/utils/CommandJournal.h"
+#include "artemis/utils/MemoryReport.h"
+#include <bitset>
 #include <map>
+#include <memory>
+#include <string>
+#include <vector>
 
 namespace artemis
 {
 class Manager;
 class Entity;
+class Aspect;
 class EntityManager;
 class ComponentManager;
 class EntitySystem;
 class EntityObserver;
+class EntityQuery;
+template<typename... Ts> class View;
+class FrameProfiler;
+class PerfCounters;
+class WorldInspector;
+class StreamingLoader;
+class Prefab;
 /**
  * The primary instance for the framework. It contains all the managers.
  *
@@ -29,6 +46,8 @@ class EntityObserver;
  */
 class World
 {
+   friend class JournalReplayer;
+   friend class EntityQuery;
 private:
    EntityManager *mEM;
 	ComponentManager *mCM;
@@ -37,12 +56,61 @@ public:
    float delta;
 
 private:
+   size_t mCleanBudget;
+
+   /*
+    * Two arenas take turns: the current one serves this frame, the other still
+    * holds what was allocated during the previous one and is reset at the end
+    * of process(), when it becomes the current one.
+    */
+   FrameArena mFrameArenas[2];
+   int mFrame;
+
+   FrameProfiler *mProfiler;
+   PerfCounters *mPerfCounters;
+   ChurnCounters *mChurnCounters;
+   WorldInspector *mInspector;
+   CommandJournal *mJournal;
+   StreamingLoader *mLoader;
+   bool mProcessing;
+
+   /*
+    * Pending entities, kept with their storage across frames: processing them
+    * only clears the used slots, so once reserved they do not allocate.
+    */
    Bag<Entity *> mAddedEntities;
 	Bag<Entity *> mChangedEntities;
 	Bag<Entity *> mDeletedEntities;
 	Bag<Entity *> mEnabledEntities;
 	Bag<Entity *> mDisabledEntities;
 
+	/*
+	 * Entities made by instantiate(), added in one go per batch on the next process().
+	 */
+	struct InstantiatedBatch
+	{
+		std::bitset<64> componentBits;
+		size_t first;
+		size_t count;
+	};
+	std::vector<Entity *> mInstantiatedEntities;
+	std::vector<InstantiatedBatch> mInstantiatedBatches;
+
+	/*
+	 * Queued by deleteAll() and the like, applied in order on the next process().
+	 */
+	struct BulkOperation
+	{
+		int command; // CommandJournal::cmDeleteAll, cmAddComponentToAll...
+		Aspect *aspect;
+		ComponentType type;
+		Component *prototype;
+		Component * (*copy)(const Component *); // null to copy with the codec of the type
+	};
+	std::vector<BulkOperation> mBulkOperations;
+
+	std::vector<EntityQuery *> mQueries;
+
 	Bag<Manager *> managersBag;
 	Bag<EntitySystem *> systemsBag;
 
@@ -116,14 +184,266 @@ public:
 	 *
 	 * @param delta time since last game loop.
 	 */
-	void setDelta(float dt) { this->delta = dt; }
+	void setDelta(float dt)
+	{
+		this->delta = dt;
+		if (mJournal)
+			mJournal->recordDelta(dt);
+	}
+
+	/**
+	 * Limits how many deleted entities get their components and memory reclaimed
+	 * per World.process(). Deleted entities are removed from systems and managers
+	 * immediately, only the cleanup is spread over the following frames.
+	 * Their ids are not reused before they are reclaimed.
+	 *
+	 * @param budget entities to reclaim per frame, 0 reclaims all of them (default).
+	 */
+	void setCleanBudget(size_t budget) { mCleanBudget = budget; }
+
+	/**
+	 * @return entities reclaimed per frame, 0 if unlimited.
+	 */
+	size_t getCleanBudget() const { return mCleanBudget; }
+
+	/**
+	 * Returns the arena for data that only lives for the current frame, e.g. scratch
+	 * buffers of systems or Bags created with it as their allocator. Everything
+	 * allocated from it is released at the end of the next World.process(), so it
+	 * must not be kept across frames.
+	 *
+	 * @return the frame arena.
+	 */
+	FrameArena * getFrameArena() { return &mFrameArenas[mFrame]; }
+
+	/**
+	 * Starts timing every World.process(): each pass over the added/changed/disabled/
+	 * enabled/deleted entities, the bulk operations, the component and entity cleanup, and begin(),
+	 * processEntities() and end() of every processed system. The profiler is owned
+	 * by the world; calling this again replaces it.
+	 *
+	 * @param frames number of frames the profiler keeps.
+	 * @return the profiler, which can be read from other threads.
+	 */
+	FrameProfiler * enableProfiler(size_t frames = 256);
+
+	/**
+	 * Stops timing and deletes the profiler.
+	 */
+	void disableProfiler();
+
+	/**
+	 * @return the profiler, null if profiling is disabled.
+	 */
+	FrameProfiler * getProfiler() { return mProfiler; }
+
+	/**
+	 * Starts sampling hardware performance counters (cycles, instructions, cache and
+	 * branch misses) around every system processed by World.process(). Must be called
+	 * on the thread that runs World.process(). The counters are owned by the world.
+	 *
+	 * @return the counters, check PerfCounters.isAvailable() for whether the system provides them.
+	 */
+	PerfCounters * enablePerfCounters();
+
+	/**
+	 * Stops sampling and deletes the counters.
+	 */
+	void disablePerfCounters();
+
+	/**
+	 * @return the performance counters, null if disabled.
+	 */
+	PerfCounters * getPerfCounters() { return mPerfCounters; }
+
+	/**
+	 * Starts counting structural changes per frame: component adds and removes,
+	 * system inserts and removes, system checks and the growths of the world's
+	 * bags, of systems known at the time of the call and of all component types.
+	 * The counters are owned by the world.
+	 *
+	 * @return the counters.
+	 */
+	ChurnCounters * enableChurnCounters();
+
+	/**
+	 * Stops counting and deletes the counters.
+	 */
+	void disableChurnCounters();
+
+	/**
+	 * @return the churn counters, null if disabled.
+	 */
+	ChurnCounters * getChurnCounters() { return mChurnCounters; }
+
+	/**
+	 * Counts the active entities by their exact set of components.
+	 *
+	 * @return every distinct component set with its number of entities, most populated first.
+	 */
+	std::vector<ChurnCounters::Archetype> takeArchetypeCensus();
+
+	/**
+	 * Reports the memory held by the world: component storage and component objects
+	 * per type, containers per system and manager, Entity objects, the identifier
+	 * pool, and the world's own frame arenas and tables. Heap held by elements of
+	 * containers, and by systems and managers outside their reportMemory(), is not counted.
+	 *
+	 * @return bytes in use and reserved.
+	 */
+	MemoryReport memoryReport();
+
+	/**
+	 * Starts a thread answering queries about this world (counts, system timings,
+	 * memory report, churn counters) on a Unix domain socket, see WorldInspector.
+	 * The simulation thread never waits on it. The inspector is owned by the world.
+	 *
+	 * @param path of the socket, an existing socket there is replaced.
+	 * @return the inspector, null if the socket could not be bound.
+	 */
+	WorldInspector * startInspector(const std::string &path);
+
+	/**
+	 * Stops the inspector thread and removes its socket.
+	 */
+	void stopInspector();
+
+	/**
+	 * Registers the component class of a type for snapshots. Its data is copied as
+	 * bytes, see ComponentCodec, and it needs a default constructor. Types that are
+	 * not registered are left out of snapshots.
+	 */
+	template<typename T, ComponentType cType>
+	void registerComponent()
+	{
+		setComponentCodec(cType, ComponentCodec::of<T>(), sizeof(T));
+	}
+
+	/**
+	 * Writes the entities added to the world, their enabled state, the data of their
+	 * registered components and the identifier pool to a file. Entities deleted,
+	 * changed, enabled or disabled since the last World.process() are saved as
+	 * they were before. The file is written next to the path and renamed over it.
+	 *
+	 * @param path of the snapshot file.
+	 * @return false if the file could not be written.
+	 */
+	bool saveSnapshot(const std::string &path);
+
+	/**
+	 * Restores a snapshot into a world that has its systems, managers and component
+	 * registrations set up but no entities yet. Entity ids are the saved ones. The
+	 * entities are queued as added, so systems and managers get them on the next
+	 * World.process().
+	 *
+	 * @param path of the snapshot file.
+	 * @return false if the file cannot be read, is not a snapshot of this version,
+	 *         holds a component type registered differently or ids that are repeated
+	 *         or out of range, or the world has entities.
+	 */
+	bool loadSnapshot(const std::string &path);
+
+	/**
+	 * Starts journaling the structural commands issued on this world to a file,
+	 * see CommandJournal. The journal is owned by the world; calling this again
+	 * starts a new one.
+	 *
+	 * @param path of the journal file, truncated.
+	 * @param capacity bytes of file mapped up front.
+	 * @return the journal, null if the file could not be created.
+	 */
+	CommandJournal * enableJournal(const std::string &path, size_t capacity = 16 * 1024 * 1024);
+
+	/**
+	 * Stops journaling and closes the file.
+	 */
+	void disableJournal();
+
+	/**
+	 * @return the journal, null if disabled.
+	 */
+	CommandJournal * getJournal() { return mJournal; }
+
+	/**
+	 * Pages entities out to an entity file, see EntityFile, and deletes them from the
+	 * world; their ids return to the pool once they are reclaimed. Use it to drop a
+	 * region nobody is near, and rehydrate() to bring it back.
+	 *
+	 * @param entities active entities to evict.
+	 * @param path of the file, overwritten.
+	 * @return false if the file could not be written, the entities are then kept.
+	 */
+	bool evict(Entity *const *entities, size_t count, const std::string &path);
+
+	/**
+	 * Adds the entities of an evicted region back with new ids, mapping the file and
+	 * filling component storage in bulk. Systems get them on the next World.process().
+	 *
+	 * @param created if not null, receives the entities in the order they were evicted.
+	 * @return false if the file cannot be read or is malformed.
+	 */
+	bool rehydrate(const std::string &path, std::vector<Entity *> *created = nullptr);
+
+	/**
+	 * Starts a loader that reads entity files on a background thread and adds their
+	 * entities over the following frames, see StreamingLoader. The loader is owned
+	 * by the world; calling this again replaces it, dropping what it had not loaded.
+	 *
+	 * @param budget entities added per World.process() at most.
+	 * @param buffers chunks read ahead.
+	 * @return the loader, queue files with StreamingLoader.load().
+	 */
+	StreamingLoader * enableStreamingLoader(size_t budget, size_t buffers = 4);
+
+	/**
+	 * Stops the loader thread and deletes the loader.
+	 */
+	void disableStreamingLoader();
+
+	/**
+	 * @return the streaming loader, null if disabled.
+	 */
+	StreamingLoader * getStreamingLoader() { return mLoader; }
+
+	/**
+	 * @return true while World.process() runs, i.e. the caller is a system or manager.
+	 */
+	bool isProcessing() const { return mProcessing; }
+
+	/**
+	 * Presizes the world's containers so that entity churn up to the given sizes
+	 * does not reallocate anything during World.process(): entity storage and ids,
+	 * the pending added/changed/deleted/enabled/disabled entities, the actives of
+	 * every system set so far, and the storage of the hinted component types.
+	 *
+	 * @param entities number of entities expected to be alive at once.
+	 * @param perComponentHints storage capacity per component type. Component storage
+	 *        is indexed by entity id, so a hint should cover the id range of the
+	 *        entities that will hold that type.
+	 */
+	void reserve(size_t entities, const std::map<ComponentType, size_t> &perComponentHints = std::map<ComponentType, size_t>());
+
+	/**
+	 * Makes the world's containers grow incrementally, relocating a few elements
+	 * on every insert once they get three quarters full instead of copying all of
+	 * them when full. Applies to systems and component types known at the time of
+	 * the call, and to component types added later.
+	 *
+	 * @param incremental true to grow incrementally, false to grow when full (default).
+	 */
+	void setIncrementalGrowth(bool incremental);
 
 	/**
 	 * Adds a entity to this world.
 	 *
 	 * @param e entity
 	 */
-	void addEntity(Entity *e) { mAddedEntities.add(e); }
+	void addEntity(Entity *e)
+	{
+		mAddedEntities.add(e);
+		if (mJournal)
+			mJournal->record(CommandJournal::cmAddToWorld, e);
+	}
 
 	/**
 	 * Ensure all systems are notified of changes to this entity.
@@ -132,7 +452,11 @@ public:
 	 *
 	 * @param e entity
 	 */
-	void changedEntity(Entity *e) { mChangedEntities.add(e);
+	void changedEntity(Entity *e)
+	{
+		mChangedEntities.add(e);
+		if (mJournal)
+			mJournal->record(CommandJournal::cmChangedInWorld, e);
 	}
 
 	/**
@@ -145,19 +469,95 @@ public:
 		if (!mDeletedEntities.contains(e)) {
 			mDeletedEntities.add(e);
 		}
+		if (mJournal)
+			mJournal->record(CommandJournal::cmDeleteFromWorld, e);
 	}
 
 	/**
 	 * (Re)enable the entity in the world, after it having being disabled.
 	 * Won't do anything unless it was already disabled.
 	 */
-	void enable(Entity *e) { mEnabledEntities.add(e); }
+	void enable(Entity *e)
+	{
+		mEnabledEntities.add(e);
+		if (mJournal)
+			mJournal->record(CommandJournal::cmEnable, e);
+	}
 
 	/**
 	 * Disable the entity from being processed. Won't delete it, it will
 	 * continue to exist but won't get processed.
 	 */
-	void disable(Entity *e) { mDisabledEntities.add(e); }
+	void disable(Entity *e)
+	{
+		mDisabledEntities.add(e);
+		if (mJournal)
+			mJournal->record(CommandJournal::cmDisable, e);
+	}
+
+	/**
+	 * Gives the enabled entities matching an aspect, without registering a system.
+	 * The result is cached and kept up to date on every process(); asking again
+	 * for an identical aspect while the result is referenced returns the same one,
+	 * and the last reference going away deletes it. Keep the reference for as long
+	 * as the query is needed, rather than asking again every frame.
+	 *
+	 * @param aspect to match against entities, deleted by the world.
+	 * @return the query, filled with the matching entities in the world.
+	 */
+	std::shared_ptr<EntityQuery> query(Aspect *aspect);
+
+	/**
+	 * Gives a typed view of the entities having all of the component classes,
+	 * handing their components to a function without a mapper or virtual call per
+	 * entity, see View. Include artemis/View.h to use it.
+	 */
+	template<typename... Ts>
+	View<Ts...> view();
+
+	/**
+	 * @return number of queries alive.
+	 */
+	size_t getQueryCount() const { return mQueries.size(); }
+
+	/**
+	 * Deletes every entity matching the aspect. Like the other bulk operations
+	 * it takes effect on the next process(), after the entities added, changed,
+	 * disabled, enabled or deleted before it, and applies to the entities in the
+	 * world by then. The matching entities are removed from each system with
+	 * one sweep over its actives, rather than one by one.
+	 *
+	 * @param aspect to match against entities, deleted by the world.
+	 */
+	void deleteAll(Aspect *aspect);
+
+	/**
+	 * Adds a copy of a component to every entity matching the aspect, replacing
+	 * a component of the same type, and updates their systems in one pass.
+	 *
+	 * @param aspect to match against entities, deleted by the world.
+	 * @param prototype the component to copy, with the copy constructor of its class.
+	 */
+	template<typename T>
+	void addComponentToAll(Aspect *aspect, const T &prototype)
+	{
+		queueBulkOperation(CommandJournal::cmAddComponentToAll, aspect, prototype.getType(), new T(prototype), &copyComponent<T>);
+	}
+
+	/**
+	 * Removes a component type from every entity matching the aspect and
+	 * updates their systems in one pass.
+	 *
+	 * @param aspect to match against entities, deleted by the world.
+	 */
+	void removeComponentFromAll(Aspect *aspect, ComponentType type);
+
+	/**
+	 * Disables every enabled entity matching the aspect.
+	 *
+	 * @param aspect to match against entities, deleted by the world.
+	 */
+	void disableAll(Aspect *aspect);
 
 	/**
 	 * Create and return a new or reused entity instance.
@@ -167,6 +567,27 @@ public:
 	 */
 	Entity * createEntity();
 
+	/**
+	 * Creates many entity instances at once, with consecutive ids that were never
+	 * used. Like createEntity(), they are not added to the world.
+	 *
+	 * @param out receives the entities.
+	 * @param count number of entities.
+	 */
+	void createEntities(Entity **out, size_t count);
+
+	/**
+	 * Creates entities from a prefab and adds them to the world. Their components
+	 * are copies of the prefab's, set in bulk, and on the next process() the systems
+	 * interested in the prefab's components get them all at once, without checking
+	 * each entity.
+	 *
+	 * @param prefab the components of the entities.
+	 * @param count number of entities.
+	 * @param out if not null, receives the entities, e.g. to set where they spawn.
+	 */
+	void instantiate(const Prefab *prefab, size_t count, Entity **out = nullptr);
+
 	/**
 	 * Get a entity having the specified id.
 	 *
@@ -215,8 +636,19 @@ public:
 	void deleteSystem(EntitySystem *system);
 
 private:
+   template<typename T>
+   static Component * copyComponent(const Component *component)
+   {
+      return new T(*static_cast<const T *>(component));
+   }
+   void queueBulkOperation(int command, Aspect *aspect, ComponentType type, Component *prototype, Component * (*copy)(const Component *));
+   void applyBulkOperation(const BulkOperation &operation);
+   void setComponentCodec(ComponentType type, const ComponentCodec &codec, size_t size);
    void notifySystems(void (EntityObserver::* func)(Entity *), Entity *e);
    void notifyManagers(void (EntityObserver::* func)(Entity *), Entity *e);
+   void notifyQueries(void (EntityObserver::* func)(Entity *), Entity *e);
+   void removeQuery(EntityQuery *query);
+   void setBagGrowthCounter(uint64_t *growths);
 
 public:
    /**
@@ -238,12 +670,39 @@ private:
 	 */
    void check(Bag<Entity *> *entities, void (EntityObserver::* func)(Entity *));
 
+	/**
+	 * Adds the instantiated entities to managers and to the systems interested in their prefab.
+	 */
+   void checkInstantiated();
+
+	/**
+	 * Applies the queued bulk operations.
+	 */
+   void checkBulkOperations();
+
 public:
 	/**
 	 * Process all non-passive systems.
 	 */
    void process();
 
+protected:
+	/**
+	 * Runs a frame of process(): the pending entities and bulk operations, the
+	 * cleanup, then runSystems, then the profiler, counters and frame arenas.
+	 */
+   void processFrame(void (*runSystems)(World *));
+
+	/**
+	 * Processes a system, sampling the performance counters around it if enabled.
+	 */
+   void processSystem(EntitySystem *system);
+
+private:
+   static void processSystems(World *world);
+
+public:
+
 	/**
 	 * Retrieves a ComponentMapper instance for fast retrieval of components from entities.
 	 *
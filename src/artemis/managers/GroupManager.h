@@ -3,7 +3,9 @@
 
 #include "artemis/Manager.h"
 #include "artemis/utils/Bag.h"
+#include "artemis/World.h"
 #include <map>
+#include <string>
 #include <vector>
 
 namespace artemis
@@ -23,7 +25,7 @@ class GroupManager : public Manager
 {
 private:
    std::map<G, Bag<Entity *> > entitiesByGroup;
-	std::map<Entity *, std::vector<G> > groupsByEntity;
+	std::map<Entity *, Bag<G> > groupsByEntity;
 
 public:
    GroupManager(): Manager(mtGroupManager) {}
@@ -43,8 +45,11 @@ public:
       Bag<Entity *> &entities = entitiesByGroup[group];
       entities.add(e);
 
-      std::vector<G> &groups = groupsByEntity[e];
-      groups.push_back(group);
+      // Entities are usually in a few groups, not the 64 of a default Bag.
+      auto itG = groupsByEntity.find(e);
+      if (itG == groupsByEntity.end())
+         itG = groupsByEntity.emplace(e, Bag<G>(4)).first;
+      itG->second.add(group);
    }
 	
 	/**
@@ -62,8 +67,8 @@ public:
 
       auto itG = groupsByEntity.find(e);
       if (itG != groupsByEntity.end()) {
-         std::vector<G> &groups = itG->second;
-         groups.erase(groups.find(group));
+         Bag<G> &groups = itG->second;
+         groups.remove(group);
       }
    }
 	
@@ -71,9 +76,9 @@ public:
    {
       auto itG = groupsByEntity.find(e);
       if (itG != groupsByEntity.end()) {
-         std::vector<G> &groups = itG->second;
+         Bag<G> &groups = itG->second;
          for (size_t i = 0; groups.size() > i; i++) {
-            auto itE = entitiesByGroup.find(groups[i]);
+            auto itE = entitiesByGroup.find(groups.get(i));
             if (itE != entitiesByGroup.end()) {
                Bag<Entity *> &entities = itE->second;
                entities.remove(e);
@@ -130,7 +135,7 @@ public:
    {
       auto itG = groupsByEntity.find(e);
       if (itG != groupsByEntity.end()) {
-         std::vector<G> &groups = itG->second;
+         Bag<G> &groups = itG->second;
          for(size_t i = 0; groups.size() > i; i++) {
             if (group == groups.get(i))
                return true;
@@ -139,11 +144,70 @@ public:
       return false;
    }
 
+	/**
+	 * Pages the entities of a group out to a file and deletes them, see World.evict().
+	 * Membership in other groups is not saved.
+	 *
+	 * @param group the group to evict, it is empty afterwards.
+	 * @param path of the file, overwritten.
+	 * @return false if there is no such group or the file could not be written.
+	 */
+	bool evict(G group, const std::string &path)
+   {
+      auto itE = entitiesByGroup.find(group);
+      if (itE == entitiesByGroup.end())
+         return false;
+      Bag<Entity *> &entities = itE->second;
+      if (!world->evict(entities.begin(), entities.size(), path))
+         return false;
+
+      // Leave the group at once rather than one Bag::remove per deleted entity.
+      for (size_t i = 0; entities.size() > i; i++) {
+         auto itG = groupsByEntity.find(entities.get(i));
+         if (itG != groupsByEntity.end()) {
+            itG->second.remove(group);
+            if (itG->second.isEmpty())
+               groupsByEntity.erase(itG);
+         }
+      }
+      entitiesByGroup.erase(itE);
+      return true;
+   }
+
+	/**
+	 * Brings an evicted group back into the world and into the group, see World.rehydrate().
+	 *
+	 * @return false if the file cannot be read or is malformed.
+	 */
+	bool rehydrate(G group, const std::string &path)
+   {
+      std::vector<Entity *> created;
+      bool ok = world->rehydrate(path, &created);
+      Bag<Entity *> &entities = entitiesByGroup[group];
+      entities.reserve(entities.size() + created.size());
+      for (size_t i = 0; i < created.size(); ++i) {
+         add(created[i], group);
+      }
+      return ok;
+   }
+
    void deleted(Entity *e) override
    {
       Manager::deleted(e);
       removeFromAllGroups(e);
    }
+
+   void reportMemory(MemoryUsage &usage) const override
+   {
+      usage.addMap(entitiesByGroup);
+      for (auto it = entitiesByGroup.begin(); it != entitiesByGroup.end(); ++it) {
+         usage.add(it->second.getUsedBytes(), it->second.getReservedBytes());
+      }
+      usage.addMap(groupsByEntity);
+      for (auto it = groupsByEntity.begin(); it != groupsByEntity.end(); ++it) {
+         usage.add(it->second.getUsedBytes(), it->second.getReservedBytes());
+      }
+   }
 };
 }
 #endif // Artemis_GroupManager_h__
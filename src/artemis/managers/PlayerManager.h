@@ -30,6 +30,7 @@ public:
 	void removeFromPlayer(Entity *e);
 	P getPlayer(Entity *e);
    void deleted(Entity *e) override;
+   void reportMemory(MemoryUsage &usage) const override;
 
 protected:
    void initialize() override {}
@@ -83,5 +84,15 @@ void PlayerManager<P>::deleted(Entity *e)
    removeFromPlayer(e);
 }
 
+template<typename P>
+void PlayerManager<P>::reportMemory(MemoryUsage &usage) const
+{
+   usage.addMap(playerByEntity);
+   usage.addMap(entitiesByPlayer);
+   for (auto it = entitiesByPlayer.begin(); it != entitiesByPlayer.end(); ++it) {
+      usage.add(it->second.getUsedBytes(), it->second.getReservedBytes());
+   }
+}
+
 }
 #endif // Artemis_PlayerManager_h__
@@ -0,0 +1,315 @@
+#include "artemis/managers/RollbackManager.h"
+#include "artemis/ComponentCodec.h"
+#include "artemis/ComponentManager.h"
+#include "artemis/Entity.h"
+#include "artemis/World.h"
+#include "artemis/utils/Instrumentation.h"
+#include <algorithm>
+#include <cstring>
+
+namespace artemis
+{
+
+namespace
+{
+
+/*
+ * An undo record covers count consecutive entities starting at id. If present, the
+ * header is followed by the previous data of their components, otherwise they did
+ * not have one.
+ */
+struct UndoRecord
+{
+   int32_t id;
+   uint16_t type;
+   uint16_t present;
+   uint32_t count;
+};
+
+}
+
+RollbackManager::RollbackManager(size_t frames, size_t bytesPerFrame): Manager(mtRollbackManager),
+   mBytesPerFrame(bytesPerFrame), mPeakFrameBytes(0), mFrameCount(0),
+   mAddedFirst(0), mAddedCount(0)
+{
+   mFrames.resize(frames > 0 ? frames : 1);
+   mRing.resize(mFrames.size() * bytesPerFrame);
+   for (size_t i = 0; i < mFrames.size(); ++i) {
+      mFrames[i].number = 0;
+      mFrames[i].undo = mRing.data() + i * bytesPerFrame;
+      mFrames[i].used = 0;
+      mFrames[i].needed = 0;
+      mFrames[i].deletions = false;
+      mFrames[i].overflowed = false;
+   }
+}
+
+void RollbackManager::initialize()
+{
+   ComponentManager *cm = world->getComponentManager();
+   std::bitset<64> types;
+   mTypes.clear();
+   for (ComponentType t = 0; t < 64; ++t) {
+      const ComponentCodec *codec = cm->getComponentCodec(t);
+      if (codec != nullptr) {
+         mTypeIds[mTypes.size()] = t;
+         TypeState state;
+         state.codec = codec;
+         mTypes.push_back(state);
+         types.set(t);
+      }
+   }
+   mChanges.attach(cm, types);
+}
+
+void RollbackManager::added(Entity *e)
+{
+   mAdded.push_back(e->getId());
+}
+
+void RollbackManager::deleted(Entity *e)
+{
+   auto it = std::find(mUndoneAdds.begin(), mUndoneAdds.end(), e->getId());
+   if (it != mUndoneAdds.end()) {
+      *it = mUndoneAdds.back();
+      mUndoneAdds.pop_back();
+      return;
+   }
+   mDeleted.push_back(e->getId());
+}
+
+char * RollbackManager::append(Frame &frame, int id, size_t type, bool present, size_t count, size_t size)
+{
+   size_t bytes = sizeof(UndoRecord) + (present ? count * size : 0);
+   frame.needed += bytes;
+   if (frame.overflowed || frame.used + bytes > mBytesPerFrame) {
+      frame.overflowed = true;
+      return nullptr;
+   }
+
+   UndoRecord record;
+   record.id = id;
+   record.type = static_cast<uint16_t>(type);
+   record.present = present ? 1 : 0;
+   record.count = static_cast<uint32_t>(count);
+   std::memcpy(frame.undo + frame.used, &record, sizeof(UndoRecord));
+   char *data = frame.undo + frame.used + sizeof(UndoRecord);
+   frame.used += bytes;
+   return data;
+}
+
+void RollbackManager::flushRun(Frame &frame, size_t type)
+{
+   if (mRun.empty())
+      return;
+   TypeState &state = mTypes[type];
+   size_t size = state.codec->size;
+   char *data = append(frame, mRun.front(), type, true, mRun.size(), size);
+   if (data != nullptr)
+      std::memcpy(data, state.data.data() + mRun.front() * size, mRun.size() * size);
+
+   // Then bring the previous state up to date with the components still present.
+   Bag<Component *> *components = world->getComponentManager()->getComponentsByType(mTypeIds[type]);
+   for (size_t i = 0; i < mRun.size(); ++i) {
+      int id = mRun[i];
+      if (state.present[id])
+         state.codec->save(components->get(id), state.data.data() + id * size);
+   }
+   mRun.clear();
+}
+
+uint64_t RollbackManager::capture()
+{
+   ARTEMIS_ZONE("RollbackManager::capture");
+   Frame &frame = mFrames[mFrameCount % mFrames.size()];
+   frame.number = mFrameCount;
+   frame.used = 0;
+   frame.needed = 0;
+   frame.overflowed = false;
+   frame.added.swap(mAdded);
+   mAdded.clear();
+   frame.deletions = !mDeleted.empty();
+   mDeleted.clear();
+
+   ComponentManager *cm = world->getComponentManager();
+   mChanges.sort();
+   for (size_t i = 0; i < mTypes.size(); ++i) {
+      const std::vector<int> &changed = mChanges.getChanged(mTypeIds[i]);
+      if (changed.empty())
+         continue;
+      TypeState &state = mTypes[i];
+      size_t size = state.codec->size;
+      Bag<Component *> *components = cm->getComponentsByType(mTypeIds[i]);
+      size_t n = static_cast<size_t>(changed.back()) + 1;
+      if (n > state.present.size()) {
+         state.present.resize(n, false);
+         state.data.resize(n * size);
+      }
+
+      for (size_t k = 0; k < changed.size(); ++k) {
+         int id = changed[k];
+         if (!mRun.empty() && id != mRun.back() + 1)
+            flushRun(frame, i);
+         if (mAddedCount > 0 && id != mAddedFirst + static_cast<int>(mAddedCount)) {
+            append(frame, mAddedFirst, i, false, mAddedCount, size);
+            mAddedCount = 0;
+         }
+
+         Component *component = components->isIndexWithinBounds(id) ? components->get(id) : nullptr;
+         bool was = state.present[id];
+         bool alive = world->getEntity(id) != nullptr;
+         if (component == nullptr || !alive) {
+            // Removed, or the entity was deleted and can no longer be restored.
+            if (was && alive)
+               mRun.push_back(id);
+            state.present[id] = false;
+         }
+         else if (!was) {
+            if (mAddedCount++ == 0)
+               mAddedFirst = id;
+            state.codec->save(component, state.data.data() + id * size);
+            state.present[id] = true;
+         }
+         else {
+            const char *current = reinterpret_cast<const char *>(component) + state.codec->offset;
+            if (std::memcmp(state.data.data() + id * size, current, size) != 0)
+               mRun.push_back(id);
+         }
+      }
+      flushRun(frame, i);
+      if (mAddedCount > 0) {
+         append(frame, mAddedFirst, i, false, mAddedCount, size);
+         mAddedCount = 0;
+      }
+   }
+   mChanges.clear();
+
+   if (frame.needed > mPeakFrameBytes)
+      mPeakFrameBytes = frame.needed;
+   return mFrameCount++;
+}
+
+uint64_t RollbackManager::getOldestFrame() const
+{
+   if (mFrameCount == 0)
+      return 0;
+   return mFrameCount - 1 > mFrames.size() ? mFrameCount - 1 - mFrames.size() : 0;
+}
+
+void RollbackManager::undo(Frame &frame)
+{
+   size_t offset = 0;
+   while (offset < frame.used) {
+      UndoRecord record;
+      std::memcpy(&record, frame.undo + offset, sizeof(UndoRecord));
+      offset += sizeof(UndoRecord);
+
+      TypeState &state = mTypes[record.type];
+      size_t size = state.codec->size;
+      ComponentType type = mTypeIds[record.type];
+      for (uint32_t c = 0; c < record.count; ++c) {
+         int id = record.id + static_cast<int>(c);
+         const char *data = frame.undo + offset;
+         offset += record.present ? size : 0;
+         Entity *e = world->getEntity(id);
+         if (e == nullptr)
+            continue;
+
+         if (static_cast<size_t>(id) >= mTouched.size())
+            mTouched.resize(id + 1, false);
+
+         if (!record.present) {
+            e->removeComponent(type);
+            state.present[id] = false;
+            mTouched[id] = true;
+            continue;
+         }
+
+         Component *component = e->getComponent(type);
+         if (component == nullptr) {
+            component = state.codec->create();
+            state.codec->load(component, data);
+            e->addComponent(component);
+            mTouched[id] = true;
+         }
+         else {
+            state.codec->load(component, data);
+         }
+         std::memcpy(state.data.data() + id * size, data, size);
+         state.present[id] = true;
+      }
+   }
+}
+
+bool RollbackManager::restore(uint64_t frame)
+{
+   if (frame >= mFrameCount || frame < getOldestFrame())
+      return false;
+   for (uint64_t f = frame + 1; f < mFrameCount; ++f) {
+      if (mFrames[f % mFrames.size()].deletions || mFrames[f % mFrames.size()].overflowed)
+         return false;
+   }
+   if (!mDeleted.empty())
+      return false;
+
+   for (uint64_t f = mFrameCount - 1; f > frame; --f) {
+      undo(mFrames[f % mFrames.size()]);
+   }
+
+   for (uint64_t f = mFrameCount - 1; f > frame; --f) {
+      Frame &undone = mFrames[f % mFrames.size()];
+      for (size_t i = 0; i < undone.added.size(); ++i) {
+         Entity *e = world->getEntity(undone.added[i]);
+         if (e != nullptr) {
+            e->deleteFromWorld();
+            mUndoneAdds.push_back(undone.added[i]);
+            if (static_cast<size_t>(undone.added[i]) < mTouched.size())
+               mTouched[undone.added[i]] = false;
+         }
+      }
+   }
+   for (size_t id = 0; id < mTouched.size(); ++id) {
+      if (mTouched[id]) {
+         world->getEntity(id)->changedInWorld();
+         mTouched[id] = false;
+      }
+   }
+
+   mFrameCount = frame + 1;
+   return true;
+}
+
+bool RollbackManager::resimulate(uint64_t frame, const std::function<void(uint64_t)> &beforeFrame)
+{
+   uint64_t current = mFrameCount;
+   if (!restore(frame))
+      return false;
+   for (uint64_t f = frame + 1; f < current; ++f) {
+      if (beforeFrame)
+         beforeFrame(f);
+      world->process();
+      capture();
+   }
+   return true;
+}
+
+void RollbackManager::reportMemory(MemoryUsage &usage) const
+{
+   usage.add(0, mRing.capacity());
+   for (size_t i = 0; i < mFrames.size(); ++i) {
+      usage.add(mFrames[i].used, 0);
+      usage.add(mFrames[i].added.size() * sizeof(int), mFrames[i].added.capacity() * sizeof(int));
+   }
+   for (size_t i = 0; i < mTypes.size(); ++i) {
+      usage.add(mTypes[i].data.size(), mTypes[i].data.capacity());
+      usage.add((mTypes[i].present.size() + 7) / 8, (mTypes[i].present.capacity() + 7) / 8);
+   }
+   usage.add(mAdded.capacity() * sizeof(int), mAdded.capacity() * sizeof(int));
+   usage.add(mDeleted.capacity() * sizeof(int), mDeleted.capacity() * sizeof(int));
+   usage.add(mUndoneAdds.capacity() * sizeof(int), mUndoneAdds.capacity() * sizeof(int));
+   usage.add((mTouched.size() + 7) / 8, (mTouched.capacity() + 7) / 8);
+   usage.add(mRun.size() * sizeof(int), mRun.capacity() * sizeof(int));
+   mChanges.reportMemory(usage);
+}
+
+}
@@ -0,0 +1,141 @@
+#ifndef Artemis_RollbackManager_h__
+#define Artemis_RollbackManager_h__
+
+#include "artemis/Manager.h"
+#include "artemis/ComponentType.h"
+#include "artemis/utils/ChangeTracker.h"
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+namespace artemis
+{
+struct ComponentCodec;
+
+/**
+ * Keeps the last frames of component state so the world can be rolled back to
+ * one of them and simulated forward again, e.g. when late remote input arrives.
+ *
+ * Call capture() after every World.process(). It looks at the components of the
+ * types registered with World.registerComponent() that a ChangeTracker saw change,
+ * so components must be written through ComponentMapper.edit() or
+ * Entity.editComponent(). The previous state of those types is kept in one
+ * contiguous array per type, and the previous data of the components that changed,
+ * were added or were removed is copied from it into the frame, a range of
+ * consecutive entities at a time.
+ *
+ * Frames are stored in a ring allocated up front, with a fixed number of bytes per
+ * frame. A frame whose changes do not fit cannot be rolled back across, see
+ * getPeakFrameBytes() to size it.
+ *
+ * restore() undoes component data, added and removed components, and deletes the
+ * entities added since. Entities deleted since cannot be brought back, nor is the
+ * enabled state rolled back; keep entities inside the rollback window disabled
+ * rather than deleted. Entities deleted by restore() release their ids on the next
+ * World.process(), so entities created again while resimulating may get other ids.
+ */
+class RollbackManager : public Manager
+{
+private:
+   struct TypeState
+   {
+      const ComponentCodec *codec;
+      std::vector<char> data;     // last captured data, codec->size bytes per entity id
+      std::vector<bool> present;  // whether the entity had the component
+   };
+
+   struct Frame
+   {
+      uint64_t number;
+      char *undo;               // records of the state before this frame, in mRing
+      size_t used;
+      size_t needed;            // bytes the records took, more than fit if overflowed
+      std::vector<int> added;   // entities added in this frame
+      bool deletions;           // entities were deleted in this frame
+      bool overflowed;          // not all records fit
+   };
+
+   std::vector<TypeState> mTypes;
+   ComponentType mTypeIds[64];
+   std::vector<char> mRing;
+   std::vector<Frame> mFrames;
+   size_t mBytesPerFrame;
+   size_t mPeakFrameBytes;
+   uint64_t mFrameCount;
+   ChangeTracker mChanges;
+   std::vector<int> mRun;        // consecutive ids whose previous data is recorded together
+   int mAddedFirst;              // consecutive ids whose component was added, recorded together
+   size_t mAddedCount;
+
+   std::vector<int> mAdded;
+   std::vector<int> mDeleted;
+   std::vector<int> mUndoneAdds; // deletions queued by restore(), not recorded as such
+   std::vector<bool> mTouched;
+
+   char * append(Frame &frame, int id, size_t type, bool present, size_t count, size_t size);
+   void flushRun(Frame &frame, size_t type);
+   void undo(Frame &frame);
+
+public:
+   /**
+    * @param frames number of frames that can be rolled back.
+    * @param bytesPerFrame undo storage preallocated per frame.
+    */
+   RollbackManager(size_t frames, size_t bytesPerFrame = 64 * 1024);
+
+   /**
+    * Starts tracking the component types registered so far.
+    */
+   void initialize() override;
+
+   void added(Entity *e) override;
+   void deleted(Entity *e) override;
+
+   /**
+    * Records the changes of the frame World.process() just finished.
+    *
+    * @return the number of the captured frame, counting from 0.
+    */
+   uint64_t capture();
+
+   /**
+    * @return number of frames captured, the current frame is getFrameCount() - 1.
+    */
+   uint64_t getFrameCount() const { return mFrameCount; }
+
+   /**
+    * @return the most bytes a captured frame needed, compare with the bytes per frame.
+    */
+   size_t getPeakFrameBytes() const { return mPeakFrameBytes; }
+
+   /**
+    * @return the oldest frame restore() can go back to.
+    */
+   uint64_t getOldestFrame() const;
+
+   /**
+    * Puts the world back into its state when the given frame was captured and drops
+    * the frames after it. Added and removed components and deleted entities take
+    * effect in systems on the next World.process().
+    *
+    * @param frame between getOldestFrame() and getFrameCount() - 1.
+    * @return false if the frame is out of range, entities were deleted since or a
+    *         frame since did not fit its undo storage.
+    */
+   bool restore(uint64_t frame);
+
+   /**
+    * Restores a frame and processes the world again up to the current frame,
+    * capturing every frame.
+    *
+    * @param frame to restore.
+    * @param beforeFrame called with the number of each frame before it is processed,
+    *        to apply the input of that frame. May be empty.
+    * @return false if the frame could not be restored.
+    */
+   bool resimulate(uint64_t frame, const std::function<void(uint64_t)> &beforeFrame);
+
+   void reportMemory(MemoryUsage &usage) const override;
+};
+}
+#endif // Artemis_RollbackManager_h__
@@ -66,6 +66,12 @@ public:
 		}
 	}
 
+	void reportMemory(MemoryUsage &usage) const override
+   {
+		usage.addMap(entitiesByTag);
+		usage.addMap(tagsByEntity);
+	}
+
 protected:
    void initialize() override {}
 
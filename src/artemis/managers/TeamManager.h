@@ -51,7 +51,7 @@ public:
 		players.add(player);
 	}
 	
-	const Bag<T> * getPlayers(T team) const
+	const Bag<P> * getPlayers(T team) const
    {
       auto it = playersByTeam.find(team);
       if (it != playersByTeam.end())
@@ -65,13 +65,22 @@ public:
       if (it != teamByPlayer.end()) {
          auto itP = playersByTeam.find(it->second);
          if (itP != playersByTeam.end()) {
-			   Bag<T> &players = itP->second;
+			   Bag<P> &players = itP->second;
 				players.remove(player);
 			}
          teamByPlayer.erase(it);
 		}
 	}
 
+	void reportMemory(MemoryUsage &usage) const override
+   {
+		usage.addMap(playersByTeam);
+		for (auto it = playersByTeam.begin(); it != playersByTeam.end(); ++it) {
+			usage.add(it->second.getUsedBytes(), it->second.getReservedBytes());
+		}
+		usage.addMap(teamByPlayer);
+	}
+
 };
 }
 #endif // Artemis_TeamManager_h__
@@ -6,8 +6,9 @@ namespace artemis
 
 void DelayedEntityProcessingSystem::processEntities(Bag<Entity *> *entities)
 {
-   for (size_t i = 0, s = entities->size(); i < s; ++i) {
-      Entity *entity = entities->get(i);
+   const Bag<Entity *> &actives = *entities;
+   for (size_t i = 0, s = actives.size(); i < s; ++i) {
+      Entity *entity = actives.get(i);
       processDelta(entity, acc);
       float remaining = getRemainingDelay(entity);
       if (remaining <= 0) {
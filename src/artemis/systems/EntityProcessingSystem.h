@@ -28,9 +28,10 @@ protected:
    virtual void process(Entity *e) = 0;
 
 	void processEntities(Bag<Entity *> *entities) override {
-      size_t s = entities->size();
+      const Bag<Entity *> &actives = *entities;
+      size_t s = actives.size();
 		for (size_t i = 0; i < s; ++i) {
-			process(entities->get(i));
+			process(actives.get(i));
 		}
 	}
 	
@@ -39,5 +40,58 @@ protected:
 	}
 	
 };
+
+/**
+ * EntityProcessingSystem without a virtual call per entity: the derived class
+ * passes itself as the template argument and defines a non-virtual
+ * void process(Entity *e), which the loop calls directly, so the compiler can
+ * inline it. Register it with World.setSystem() like any other system.
+ *
+ * In a StaticWorld, checkProcessing(), begin() and end() are called directly as
+ * well, so where the derived class overrides them they must be public, like process().
+ *
+ * class MovementSystem : public StaticEntityProcessingSystem<MovementSystem> {
+ * public:
+ *    void process(Entity *e) { ... }
+ * };
+ */
+template<typename Derived>
+class StaticEntityProcessingSystem : public EntitySystem
+{
+   template<typename... Systems> friend class StaticWorld;
+public:
+   typedef Derived StaticProcessing;
+
+   StaticEntityProcessingSystem(Aspect *aspect, EntitySystemType tp): EntitySystem(aspect, tp) {}
+
+private:
+	/*
+	 * A processing pass for StaticWorld, which holds the Derived itself, so the
+	 * hooks are called by name instead of through the vtable.
+	 */
+	void processStatic(Bag<Entity *> *entities) {
+		Derived *self = static_cast<Derived *>(this);
+		if (self->Derived::checkProcessing()) {
+			self->Derived::begin();
+			self->Derived::processEntities(entities);
+			self->Derived::end();
+		}
+	}
+
+protected:
+	void processEntities(Bag<Entity *> *entities) override final {
+		Derived *self = static_cast<Derived *>(this);
+		const Bag<Entity *> &actives = *entities;
+		Entity *const *it = actives.begin();
+		Entity *const *end = actives.end();
+		for (; it != end; ++it) {
+			self->process(*it);
+		}
+	}
+
+	bool checkProcessing() override {
+		return true;
+	}
+};
 }
 #endif // Artemis_EntityProcessingSystem_h__
@@ -30,11 +30,55 @@ protected:
 	
 	void processEntities(Bag<Entity *> *entities) override
    {
-		for (size_t i = 0, s = entities->size(); i < s; ++i) {
-			process(entities->get(i));
+      const Bag<Entity *> &actives = *entities;
+		for (size_t i = 0, s = actives.size(); i < s; ++i) {
+			process(actives.get(i));
 		}
 	}
 
 };
+
+/**
+ * IntervalEntityProcessingSystem without a virtual call per entity, see
+ * StaticEntityProcessingSystem: the derived class passes itself as the template
+ * argument and defines a non-virtual void process(Entity *e). In a StaticWorld
+ * begin() and end() are called directly as well, so where the derived class
+ * overrides them they must be public, like process().
+ */
+template<typename Derived>
+class StaticIntervalEntityProcessingSystem : public IntervalEntitySystem
+{
+   template<typename... Systems> friend class StaticWorld;
+public:
+   typedef Derived StaticProcessing;
+
+   StaticIntervalEntityProcessingSystem(Aspect *aspect, float interval, EntitySystemType tp): IntervalEntitySystem(aspect, interval, tp) {}
+
+private:
+	/*
+	 * A processing pass for StaticWorld, see StaticEntityProcessingSystem.
+	 */
+	void processStatic(Bag<Entity *> *entities)
+   {
+		Derived *self = static_cast<Derived *>(this);
+		if (self->Derived::checkProcessing()) {
+			self->Derived::begin();
+			self->Derived::processEntities(entities);
+			self->Derived::end();
+		}
+	}
+
+protected:
+	void processEntities(Bag<Entity *> *entities) override final
+   {
+		Derived *self = static_cast<Derived *>(this);
+		const Bag<Entity *> &actives = *entities;
+		Entity *const *it = actives.begin();
+		Entity *const *end = actives.end();
+		for (; it != end; ++it) {
+			self->process(*it);
+		}
+	}
+};
 }
 #endif // Artemis_IntervalEntityProcessingSystem_h__
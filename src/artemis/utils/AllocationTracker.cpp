@@ -0,0 +1,263 @@
+#include "artemis/utils/AllocationTracker.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+#if defined(__GNUC__)
+#define ARTEMIS_TLS_MODEL __attribute__((tls_model("initial-exec")))
+#else
+#define ARTEMIS_TLS_MODEL
+#endif
+
+namespace artemis
+{
+
+namespace
+{
+
+/*
+ * Plain data only: it is touched from inside malloc, where nothing may allocate.
+ */
+struct TrackerState
+{
+   bool tracking;
+   int kind;
+   unsigned int type;
+   AllocationTracker::Report current;
+   AllocationTracker::Report last;
+};
+
+thread_local TrackerState state ARTEMIS_TLS_MODEL;
+
+bool strict = false;
+AllocationTracker::FailureHandler failureHandler = nullptr;
+
+void defaultFailureHandler(const AllocationTracker::Report &report)
+{
+   std::fprintf(stderr, "artemis: steady-state frame allocated\n");
+   AllocationTracker::print(report);
+   std::abort();
+}
+
+}
+
+AllocationTracker::FrameGuard::FrameGuard()
+{
+   std::memset(&state.current, 0, sizeof(Report));
+   state.kind = skWorld;
+   state.type = 0;
+   state.tracking = true;
+}
+
+AllocationTracker::FrameGuard::~FrameGuard()
+{
+   state.tracking = false;
+   state.last = state.current;
+   if (strict && state.last.allocations > 0) {
+      (failureHandler != nullptr ? failureHandler : defaultFailureHandler)(state.last);
+   }
+}
+
+AllocationTracker::ScopeGuard::ScopeGuard(ScopeKind kind, unsigned int type): mKind(state.kind), mType(state.type)
+{
+   state.kind = kind;
+   state.type = type;
+}
+
+AllocationTracker::ScopeGuard::~ScopeGuard()
+{
+   state.kind = mKind;
+   state.type = mType;
+}
+
+const AllocationTracker::Report & AllocationTracker::getLastFrame()
+{
+   return state.last;
+}
+
+void AllocationTracker::setStrict(bool s)
+{
+   strict = s;
+}
+
+bool AllocationTracker::isStrict()
+{
+   return strict;
+}
+
+void AllocationTracker::setFailureHandler(FailureHandler handler)
+{
+   failureHandler = handler;
+}
+
+void AllocationTracker::print(const Report &report)
+{
+   std::fprintf(stderr, "allocations: %zu (%zu bytes), deallocations: %zu\n",
+      report.allocations, report.bytes, report.deallocations);
+   if (report.worldAllocations > 0) {
+      std::fprintf(stderr, "  world: %zu (%zu bytes)\n", report.worldAllocations, report.worldBytes);
+   }
+   for (size_t i = 0; i < MAX_TYPES; ++i) {
+      if (report.managerAllocations[i] > 0) {
+         std::fprintf(stderr, "  manager %zu: %zu (%zu bytes)\n", i, report.managerAllocations[i], report.managerBytes[i]);
+      }
+   }
+   for (size_t i = 0; i < MAX_TYPES; ++i) {
+      if (report.systemAllocations[i] > 0) {
+         std::fprintf(stderr, "  system %zu: %zu (%zu bytes)\n", i, report.systemAllocations[i], report.systemBytes[i]);
+      }
+   }
+}
+
+void AllocationTracker::recordAllocation(size_t bytes)
+{
+   TrackerState &s = state;
+   if (!s.tracking)
+      return;
+
+   s.current.allocations++;
+   s.current.bytes += bytes;
+   if (s.kind == skManager && s.type < MAX_TYPES) {
+      s.current.managerAllocations[s.type]++;
+      s.current.managerBytes[s.type] += bytes;
+   }
+   else if (s.kind == skSystem && s.type < MAX_TYPES) {
+      s.current.systemAllocations[s.type]++;
+      s.current.systemBytes[s.type] += bytes;
+   }
+   else {
+      s.current.worldAllocations++;
+      s.current.worldBytes += bytes;
+   }
+}
+
+void AllocationTracker::recordDeallocation()
+{
+   if (state.tracking) {
+      state.current.deallocations++;
+   }
+}
+
+}
+
+#ifdef ARTEMIS_TRACK_ALLOCATIONS
+
+#if defined(__GLIBC__)
+
+/*
+ * With glibc the malloc family is replaced and forwards to the libc implementation,
+ * operator new goes through malloc so it is counted once.
+ */
+extern "C" {
+void * __libc_malloc(size_t size);
+void * __libc_calloc(size_t count, size_t size);
+void * __libc_realloc(void *p, size_t size);
+void * __libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *p);
+
+void * malloc(size_t size)
+{
+   artemis::AllocationTracker::recordAllocation(size);
+   return __libc_malloc(size);
+}
+
+void * calloc(size_t count, size_t size)
+{
+   artemis::AllocationTracker::recordAllocation(count * size);
+   return __libc_calloc(count, size);
+}
+
+void * realloc(void *p, size_t size)
+{
+   artemis::AllocationTracker::recordAllocation(size);
+   return __libc_realloc(p, size);
+}
+
+int posix_memalign(void **p, size_t alignment, size_t size)
+{
+   if (alignment < sizeof(void *) || (alignment & (alignment - 1)) != 0)
+      return EINVAL;
+   artemis::AllocationTracker::recordAllocation(size);
+   *p = __libc_memalign(alignment, size);
+   return *p != nullptr ? 0 : ENOMEM;
+}
+
+void free(void *p)
+{
+   if (p != nullptr) {
+      artemis::AllocationTracker::recordDeallocation();
+   }
+   __libc_free(p);
+}
+}
+
+#define ARTEMIS_TRACKED_MALLOC(size) std::malloc(size)
+#define ARTEMIS_TRACKED_FREE(p) std::free(p)
+
+#else
+
+static void * trackedMalloc(size_t size)
+{
+   artemis::AllocationTracker::recordAllocation(size);
+   return std::malloc(size);
+}
+
+static void trackedFree(void *p)
+{
+   if (p != nullptr) {
+      artemis::AllocationTracker::recordDeallocation();
+   }
+   std::free(p);
+}
+
+#define ARTEMIS_TRACKED_MALLOC(size) trackedMalloc(size)
+#define ARTEMIS_TRACKED_FREE(p) trackedFree(p)
+
+#endif // __GLIBC__
+
+void * operator new(size_t size)
+{
+   void *p = ARTEMIS_TRACKED_MALLOC(size ? size : 1);
+   if (p == nullptr)
+      throw std::bad_alloc();
+   return p;
+}
+
+void * operator new[](size_t size)
+{
+   return operator new(size);
+}
+
+void * operator new(size_t size, const std::nothrow_t &) noexcept
+{
+   return ARTEMIS_TRACKED_MALLOC(size ? size : 1);
+}
+
+void * operator new[](size_t size, const std::nothrow_t &) noexcept
+{
+   return ARTEMIS_TRACKED_MALLOC(size ? size : 1);
+}
+
+void operator delete(void *p) noexcept
+{
+   ARTEMIS_TRACKED_FREE(p);
+}
+
+void operator delete[](void *p) noexcept
+{
+   ARTEMIS_TRACKED_FREE(p);
+}
+
+void operator delete(void *p, const std::nothrow_t &) noexcept
+{
+   ARTEMIS_TRACKED_FREE(p);
+}
+
+void operator delete[](void *p, const std::nothrow_t &) noexcept
+{
+   ARTEMIS_TRACKED_FREE(p);
+}
+
+#endif // ARTEMIS_TRACK_ALLOCATIONS
@@ -0,0 +1,110 @@
+#ifndef Artemis_AllocationTracker_h__
+#define Artemis_AllocationTracker_h__
+
+#include <cstddef>
+
+namespace artemis
+{
+
+/**
+ * Counts heap allocations made during World.process(), for locking in
+ * allocation-free frames. Only compiled in when ARTEMIS_TRACK_ALLOCATIONS is
+ * defined: global operator new/delete (and malloc/calloc/realloc/free with glibc)
+ * are then replaced, and each allocation made on the thread running
+ * World.process() is attributed to the manager or system being run at the time.
+ *
+ * To fail a test when a steady-state frame allocates, warm the world up, then
+ * call setStrict(true) and optionally setFailureHandler() with a handler that
+ * reports to the test framework. The default handler prints the report and aborts.
+ */
+class AllocationTracker
+{
+public:
+   static const size_t MAX_TYPES = 64;
+
+   enum ScopeKind {
+      skWorld = 0,
+      skManager,
+      skSystem
+   };
+
+   /**
+    * Allocations of one frame. Allocations outside managers and systems, or by
+    * types past MAX_TYPES, count for the world.
+    */
+   struct Report
+   {
+      size_t allocations;
+      size_t deallocations;
+      size_t bytes;
+      size_t worldAllocations;
+      size_t worldBytes;
+      size_t managerAllocations[MAX_TYPES];
+      size_t managerBytes[MAX_TYPES];
+      size_t systemAllocations[MAX_TYPES];
+      size_t systemBytes[MAX_TYPES];
+   };
+
+   typedef void (*FailureHandler)(const Report &report);
+
+   /**
+    * Tracks allocations between its construction and destruction,
+    * the report is then available through getLastFrame().
+    */
+   class FrameGuard
+   {
+   public:
+      FrameGuard();
+      ~FrameGuard();
+   };
+
+   /**
+    * Attributes allocations to a manager or system until it goes out of scope.
+    */
+   class ScopeGuard
+   {
+   private:
+      int mKind;
+      unsigned int mType;
+   public:
+      ScopeGuard(ScopeKind kind, unsigned int type);
+      ~ScopeGuard();
+   };
+
+   /**
+    * @return the report of the last tracked frame on this thread.
+    */
+   static const Report & getLastFrame();
+
+   /**
+    * In strict mode the failure handler is called for every tracked frame that allocated.
+    */
+   static void setStrict(bool strict);
+   static bool isStrict();
+
+   /**
+    * @param handler called with the report of a frame that allocated in strict mode, null for the default.
+    */
+   static void setFailureHandler(FailureHandler handler);
+
+   /**
+    * Writes a human readable report to stderr.
+    */
+   static void print(const Report &report);
+
+   // Called by the allocation hooks.
+   static void recordAllocation(size_t bytes);
+   static void recordDeallocation();
+};
+
+}
+
+#ifdef ARTEMIS_TRACK_ALLOCATIONS
+#define ARTEMIS_ALLOCATION_FRAME() artemis::AllocationTracker::FrameGuard artemisAllocationFrame__
+#define ARTEMIS_ALLOCATION_SCOPE(kind, type) artemis::AllocationTracker::ScopeGuard artemisAllocationScope__(artemis::AllocationTracker::kind, type)
+#else
+#define ARTEMIS_ALLOCATION_FRAME()
+#define ARTEMIS_ALLOCATION_SCOPE(kind, type)
+#endif // ARTEMIS_TRACK_ALLOCATIONS
+
+#endif // Artemis_AllocationTracker_h__
@@ -0,0 +1,59 @@
+#include "artemis/utils/Allocator.h"
+#include <cstdlib>
+#include <new>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#endif
+
+namespace artemis
+{
+
+namespace
+{
+
+class HeapAllocator : public Allocator
+{
+public:
+   void * allocate(size_t bytes, size_t alignment) override
+   {
+      // operator new is suitably aligned for any fundamental type
+      if (alignment <= alignof(std::max_align_t))
+         return ::operator new(bytes);
+
+#if defined(_WIN32)
+      void *p = _aligned_malloc(bytes ? bytes : 1, alignment);
+#else
+      void *p = nullptr;
+      if (posix_memalign(&p, alignment, bytes ? bytes : 1) != 0)
+         p = nullptr;
+#endif
+      if (p == nullptr)
+         throw std::bad_alloc();
+      return p;
+   }
+
+   void deallocate(void *p, size_t bytes, size_t alignment) override
+   {
+      if (alignment <= alignof(std::max_align_t)) {
+         ::operator delete(p);
+         return;
+      }
+
+#if defined(_WIN32)
+      _aligned_free(p);
+#else
+      std::free(p);
+#endif
+   }
+};
+
+}
+
+Allocator * Allocator::getDefault()
+{
+   static HeapAllocator heap;
+   return &heap;
+}
+
+}
@@ -0,0 +1,45 @@
+#ifndef Artemis_Allocator_h__
+#define Artemis_Allocator_h__
+
+#include <cstddef>
+
+namespace artemis
+{
+
+/**
+ * Source of raw memory for containers such as Bag.
+ * The default allocator uses the general heap; other implementations
+ * can hand out memory from arenas or pools.
+ */
+class Allocator
+{
+public:
+   virtual ~Allocator() {}
+
+   /**
+    * Allocates a block of memory.
+    *
+    * @param bytes size of the block.
+    * @param alignment required alignment of the block, a power of two.
+    * @return the block, never null.
+    */
+   virtual void * allocate(size_t bytes, size_t alignment) = 0;
+
+   /**
+    * Returns a block obtained from allocate().
+    *
+    * @param p the block, may be null.
+    * @param bytes size the block was allocated with.
+    * @param alignment alignment the block was allocated with.
+    */
+   virtual void deallocate(void *p, size_t bytes, size_t alignment) = 0;
+
+   /**
+    * Returns the allocator using the general heap.
+    * @return the heap allocator, shared by everyone.
+    */
+   static Allocator * getDefault();
+};
+
+}
+#endif // Artemis_Allocator_h__
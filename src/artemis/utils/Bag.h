@@ -1,39 +1,196 @@
 #ifndef Artemis_Bag_h__
 #define Artemis_Bag_h__
 
+#include "artemis/utils/Allocator.h"
+#include <cstdint>
 #include <cstring>
-#include <iostream>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace artemis
 {
+
+/*
+ * Copies elements where the element type allows it. Incremental growth keeps two
+ * copies of the relocated elements, so it is only available for copyable types.
+ */
+template<typename E, bool = std::is_copy_constructible<E>::value && std::is_copy_assignable<E>::value>
+struct BagCopier
+{
+    static const bool enabled = true;
+    static void construct(E *to, const E &from) { new (to) E(from); }
+    static void assign(E &to, const E &from) { to = from; }
+};
+
+template<typename E>
+struct BagCopier<E, false>
+{
+    static const bool enabled = false;
+    static void construct(E *to, const E &from) {}
+    static void assign(E &to, const E &from) {}
+};
+
 /**
  * Collection type a bit like ArrayList but does not preserve the order of its
  * entities, speedwise it is very good, especially suited for games.
  *
+ * Holds any value type. Every slot within capacity holds an element; slots past
+ * size() hold a value-initialized one (null for pointers), so bags indexed by id
+ * can be read anywhere within capacity. Elements are contiguous, begin() and end()
+ * work with range-for and STL algorithms. Memory comes from a pluggable Allocator.
+ *
  * @port   Vladimir Ivanov (ArCorvus)
  */
-
 template<typename E>
-class Bag
+class Bag /*final*/
 {
 public:
-    virtual void dummy() = 0;
-};
+    typedef E value_type;
+    typedef E* iterator;
+    typedef const E* const_iterator;
 
-template<typename E>
-class Bag<E*> /*final*/
-{
 private:
-    E**mData;
+    static const bool trivial = std::is_trivial<E>::value;
+
+    E *mData;
     size_t mSize;
     size_t mCapacity;
+    Allocator *mAllocator;
+
+    // Storage being filled in the background when growing incrementally.
+    E *mNext;
+    size_t mNextCapacity;
+    size_t mMigrated;
+    bool mIncremental;
 
-    void init(size_t capacity)
+    // Where growths are counted for churn statistics, null if not counted.
+    uint64_t *mGrowths;
+
+    void init(size_t capacity, Allocator *allocator)
     {
-        mCapacity = capacity;
+        mData = nullptr;
         mSize = 0;
-        mData = new E*[capacity];
-        clear();
+        mCapacity = 0;
+        mAllocator = allocator != nullptr ? allocator : Allocator::getDefault();
+        mNext = nullptr;
+        mNextCapacity = 0;
+        mMigrated = 0;
+        mIncremental = false;
+        mGrowths = nullptr;
+        grow(capacity);
+    }
+
+    E * allocate(size_t capacity)
+    {
+        return static_cast<E *>(mAllocator->allocate(sizeof(E)*capacity, alignof(E)));
+    }
+
+    void deallocate(E *data, size_t constructed, size_t capacity)
+    {
+        if (data == nullptr)
+            return;
+
+        if (!std::is_trivially_destructible<E>::value)
+        {
+            for (size_t i = 0; i < constructed; ++i)
+            {
+                data[i].~E();
+            }
+        }
+        mAllocator->deallocate(data, sizeof(E)*capacity, alignof(E));
+    }
+
+    static void valueConstruct(E *data, size_t begin, size_t end)
+    {
+        if (trivial)
+        {
+            if (end > begin)
+                std::memset(static_cast<void *>(data + begin), 0, sizeof(E)*(end - begin));
+            return;
+        }
+        for (size_t i = begin; i < end; ++i)
+        {
+            new (data + i) E();
+        }
+    }
+
+    static void copyConstruct(E *to, const E *from, size_t begin, size_t end)
+    {
+        if (trivial)
+        {
+            if (end > begin)
+                std::memcpy(static_cast<void *>(to + begin), static_cast<const void *>(from + begin), sizeof(E)*(end - begin));
+            return;
+        }
+        for (size_t i = begin; i < end; ++i)
+        {
+            BagCopier<E>::construct(to + i, from[i]);
+        }
+    }
+
+    void store(size_t index, E &&e)
+    {
+        mData[index] = std::move(e);
+        if (mNext != nullptr && index < mMigrated)
+        {
+            BagCopier<E>::assign(mNext[index], mData[index]);
+        }
+    }
+
+    /**
+     * Starts or continues relocating into the next storage, a slice per call, so
+     * that it is complete by the time the current storage is full. Relocation
+     * starts once the bag is three quarters full.
+     */
+    void migrate()
+    {
+        if (mNext == nullptr)
+        {
+            if (mSize < mCapacity - mCapacity / 4)
+                return;
+
+            mNextCapacity = (mCapacity * 3) / 2 + 1;
+            mNext = allocate(mNextCapacity);
+            mMigrated = 0;
+            if (mGrowths != nullptr)
+                ++*mGrowths;
+        }
+
+        size_t left = mCapacity > mSize ? mCapacity - mSize : 1;
+        size_t end = mMigrated + (mNextCapacity - mMigrated + left - 1) / left;
+        relocate(end < mNextCapacity ? end : mNextCapacity);
+    }
+
+    void finishMigration()
+    {
+        if (mNext != nullptr)
+        {
+            relocate(mNextCapacity);
+        }
+    }
+
+    void relocate(size_t end)
+    {
+        if (mMigrated < mCapacity)
+        {
+            copyConstruct(mNext, mData, mMigrated, end < mCapacity ? end : mCapacity);
+        }
+        if (end > mCapacity)
+        {
+            valueConstruct(mNext, mMigrated > mCapacity ? mMigrated : mCapacity, end);
+        }
+        mMigrated = end;
+
+        if (mMigrated == mNextCapacity)
+        {
+            deallocate(mData, mCapacity, mCapacity);
+            mData = mNext;
+            mCapacity = mNextCapacity;
+            mNext = nullptr;
+            mNextCapacity = 0;
+            mMigrated = 0;
+        }
     }
 
 public:
@@ -43,7 +200,7 @@ public:
      */
     Bag()
     {
-        init(64);
+        init(64, nullptr);
     }
 
     /**
@@ -51,15 +208,60 @@ public:
      *
      * @param capacity
      *            the initial capacity of Bag
+     * @param allocator
+     *            where the Bag gets its memory from, null for the heap
+     */
+    Bag(int capacity, Allocator *allocator = nullptr)
+    {
+        init(capacity, allocator);
+    }
+
+    Bag(const Bag<E> &other)
+    {
+        init(0, other.mAllocator);
+        if (other.mCapacity > 0)
+        {
+            mData = allocate(other.mCapacity);
+            mCapacity = other.mCapacity;
+            copyConstruct(mData, other.mData, 0, other.mSize);
+            valueConstruct(mData, other.mSize, mCapacity);
+            mSize = other.mSize;
+        }
+        mIncremental = other.mIncremental;
+    }
+
+    /**
+     * Takes over the storage of another Bag, leaving it empty with no capacity.
      */
-    Bag(int capacity)
+    Bag(Bag<E> &&other)
+    {
+        init(0, other.mAllocator);
+        swap(other);
+    }
+
+    Bag<E> & operator=(Bag<E> other)
     {
-        init(capacity);
+        swap(other);
+        return *this;
     }
 
     ~Bag()
     {
-        delete[] mData;
+        deallocate(mData, mCapacity, mCapacity);
+        deallocate(mNext, mMigrated, mNextCapacity);
+    }
+
+    void swap(Bag<E> &other)
+    {
+        std::swap(mData, other.mData);
+        std::swap(mSize, other.mSize);
+        std::swap(mCapacity, other.mCapacity);
+        std::swap(mAllocator, other.mAllocator);
+        std::swap(mNext, other.mNext);
+        std::swap(mNextCapacity, other.mNextCapacity);
+        std::swap(mMigrated, other.mMigrated);
+        std::swap(mIncremental, other.mIncremental);
+        std::swap(mGrowths, other.mGrowths);
     }
 
     /**
@@ -70,30 +272,32 @@ public:
      *            the index of element to be removed
      * @return element that was removed from the Bag
      */
-    E* remove(int index)
+    E removeAt(size_t index)
     {
-    	E* e = mData[index]; // make copy of element* to remove so it can be returned
-    	mData[index] = mData[--size]; // overwrite item to remove with last element
-    	mData[size] = nullptr; // null last element*
-    	return e;
+        E e = std::move(mData[index]); // make copy of element to remove so it can be returned
+        if (index != --mSize)
+        {
+            store(index, std::move(mData[mSize])); // overwrite item to remove with last element
+        }
+        store(mSize, E()); // null last element
+        return e;
     }
 
-
     /**
      * Remove and return the last object in the bag.
      *
      * @return the last object in the bag, null if empty.
      */
-    E* removeLast()
+    E removeLast()
     {
         if (mSize > 0)
         {
-            E* e = mData[--mSize];
-            mData[mSize] = nullptr;
+            E e = std::move(mData[--mSize]);
+            store(mSize, E());
             return e;
         }
 
-        return nullptr;
+        return E();
     }
 
     /**
@@ -105,14 +309,13 @@ public:
      *            element to be removed from this list, if present
      * @return <tt>true</tt> if this list contained the specified element
      */
-    bool remove(const E *e)
+    bool remove(const E &e)
     {
         for (size_t i = 0; i < mSize; ++i)
         {
             if (e == mData[i])
             {
-                mData[i] = mData[--mSize]; // overwrite item to remove with last element
-                mData[mSize] = nullptr; // null last element
+                removeAt(i);
                 return true;
             }
         }
@@ -120,13 +323,74 @@ public:
         return false;
     }
 
+    /**
+     * Removes the first count elements of this Bag, shifting the remaining
+     * elements down. Unlike remove() this keeps the order of the elements
+     * that are left, so the Bag can be drained as a queue.
+     *
+     * @param count
+     *            number of elements to remove from the front
+     */
+    void removeFirst(size_t count)
+    {
+        if (count >= mSize)
+        {
+            clear();
+            return;
+        }
+
+        for (size_t i = count; i < mSize; ++i)
+        {
+            store(i - count, std::move(mData[i]));
+        }
+        for (size_t i = mSize - count; i < mSize; ++i)
+        {
+            store(i, E());
+        }
+        mSize -= count;
+    }
+
+    /**
+     * Removes every element the predicate holds for in a single pass, keeping
+     * the order of the elements that are left. Cheaper than calling remove()
+     * for each of many elements.
+     *
+     * @param predicate
+     *            called once per element, returns true to remove it
+     * @return number of elements removed
+     */
+    template<typename Predicate>
+    size_t removeIf(Predicate predicate)
+    {
+        size_t kept = 0;
+        for (size_t i = 0; i < mSize; ++i)
+        {
+            if (!predicate(mData[i]))
+            {
+                if (kept != i)
+                {
+                    store(kept, std::move(mData[i]));
+                }
+                kept++;
+            }
+        }
+        for (size_t i = kept; i < mSize; ++i)
+        {
+            store(i, E());
+        }
+
+        size_t removed = mSize - kept;
+        mSize = kept;
+        return removed;
+    }
+
     /**
      * Check if bag contains this element.
      *
      * @param e
      * @return
      */
-    bool contains(const E *e) const
+    bool contains(const E &e) const
     {
         for (size_t i = 0; i < mSize; ++i)
         {
@@ -147,19 +411,19 @@ public:
      *            Bag containing elements to be removed from this Bag
      * @return {@code true} if this Bag changed as a result of the call
      */
-    bool removeAll(const Bag<E*> &bag)
+    bool removeAll(const Bag<E> &bag)
     {
         bool modified = false;
 
-        for (int i = 0; i < bag.size(); ++i)
+        for (size_t i = 0; i < bag.size(); ++i)
         {
-            const E* &e1 = bag.get(i);
+            const E &e1 = bag.get(i);
 
-            for (int j = size-1; j >= 0; --j)
+            for (size_t j = mSize; j > 0; --j)
             {
-                if (e1 == mData[j])
+                if (e1 == mData[j - 1])
                 {
-                    remove(j);
+                    removeAt(j - 1);
                     modified = true;
                     break;
                 }
@@ -172,14 +436,34 @@ public:
 
 
     /**
-     * Returns the element at the specified position in Bag.
+     * Returns the element at the specified position in Bag. The mutable
+     * overloads, like the mutable begin() and end(), first complete a pending
+     * incremental growth so that writes through the reference are not lost;
+     * read through a const Bag to leave it spread over the next inserts.
      *
      * @param index
      *            index of the element to return
      * @return the element at the specified position in bag
      */
-    E* get(int index) const
+    const E & get(size_t index) const
+    {
+        return mData[index];
+    }
+
+    E & get(size_t index)
     {
+        finishMigration();
+        return mData[index];
+    }
+
+    const E & operator[](size_t index) const
+    {
+        return mData[index];
+    }
+
+    E & operator[](size_t index)
+    {
+        finishMigration();
         return mData[index];
     }
 
@@ -198,11 +482,27 @@ public:
      *
      * @return the number of elements the bag can hold without growing.
      */
-    int capacity() const
+    size_t capacity() const
     {
         return mCapacity;
     }
 
+    /**
+     * @return bytes taken by the elements in the bag, not counting what they own.
+     */
+    size_t getUsedBytes() const
+    {
+        return mSize * sizeof(E);
+    }
+
+    /**
+     * @return bytes of storage held by the bag, including a storage being grown into.
+     */
+    size_t getReservedBytes() const
+    {
+        return (mCapacity + (mNext != nullptr ? mNextCapacity : 0)) * sizeof(E);
+    }
+
     /**
      * Checks if the internal storage supports this index.
      *
@@ -211,7 +511,7 @@ public:
      */
     bool isIndexWithinBounds(int index) const
     {
-        return index < capacity();
+        return index >= 0 && static_cast<size_t>(index) < mCapacity;
     }
 
     /**
@@ -224,6 +524,49 @@ public:
         return mSize == 0;
     }
 
+    iterator begin() { finishMigration(); return mData; }
+    iterator end() { finishMigration(); return mData + mSize; }
+    const_iterator begin() const { return mData; }
+    const_iterator end() const { return mData + mSize; }
+
+    /**
+     * Returns the allocator this bag gets its memory from.
+     */
+    Allocator * getAllocator() const
+    {
+        return mAllocator;
+    }
+
+    /**
+     * Counts each time the bag grows into larger storage, for churn statistics.
+     *
+     * @param growths counter to increment, null to stop counting.
+     */
+    void setGrowthCounter(uint64_t *growths)
+    {
+        mGrowths = growths;
+    }
+
+    /**
+     * Moves the bag to another allocator. Elements are moved into new storage of
+     * at least the given capacity and the old storage is given back to the old allocator.
+     *
+     * @param allocator where the Bag gets its memory from, null for the heap
+     * @param capacity the capacity of the new storage
+     */
+    void setAllocator(Allocator *allocator, size_t capacity)
+    {
+        Bag<E> moved(capacity > mSize ? capacity : mSize, allocator);
+        for (size_t i = 0; i < mSize; ++i)
+        {
+            moved.mData[i] = std::move(mData[i]);
+        }
+        moved.mSize = mSize;
+        moved.mIncremental = mIncremental;
+        moved.mGrowths = mGrowths;
+        swap(moved);
+    }
+
     /**
      * Adds the specified element to the end of this bag. if needed also
      * increases the capacity of the bag.
@@ -231,15 +574,20 @@ public:
      * @param e
      *            element to be added to this list
      */
-    void add(E* e)
+    void add(E e)
     {
+        if (mIncremental)
+        {
+            migrate();
+        }
+
         // is size greater than capacity increase capacity
         if (mSize == mCapacity)
         {
             grow();
         }
 
-        mData[mSize++] = e;
+        store(mSize++, std::move(e));
     }
 
     /**
@@ -248,32 +596,56 @@ public:
      * @param index position of element
      * @param e the element
      */
-    void set(size_t index, E* e)
+    void set(size_t index, E e)
     {
         if (index >= mCapacity)
         {
-            grow(index*2);
+            grow(index*2 + 1);
         }
 
         if (mSize < index+1)
             mSize = index+1;
 
-        mData[index] = e;
+        store(index, std::move(e));
+
+        if (mIncremental)
+        {
+            migrate();
+        }
     }
 
     void grow()
     {
-        int newCapacity = (mCapacity * 3) / 2 + 1;
+        size_t newCapacity = (mCapacity * 3) / 2 + 1;
         grow(newCapacity);
     }
 
-    void grow(int newCapacity)
+    void grow(size_t newCapacity)
     {
-        E** oldData = mData;
-        mData = new E*[newCapacity];
-        std::memset(mData, 0, sizeof(E*)*newCapacity);
-        std::memcpy(mData, oldData, mCapacity);
-        delete[] oldData;
+        finishMigration();
+        if (newCapacity <= mCapacity)
+            return;
+
+        if (mCapacity > 0 && mGrowths != nullptr)
+        {
+            ++*mGrowths;
+        }
+
+        E *data = allocate(newCapacity);
+        if (trivial && mCapacity > 0)
+        {
+            std::memcpy(static_cast<void *>(data), static_cast<const void *>(mData), sizeof(E)*mCapacity);
+        }
+        else if (!trivial)
+        {
+            for (size_t i = 0; i < mCapacity; ++i)
+            {
+                new (data + i) E(std::move(mData[i]));
+            }
+        }
+        valueConstruct(data, mCapacity, newCapacity);
+        deallocate(mData, mCapacity, mCapacity);
+        mData = data;
         mCapacity = newCapacity;
     }
 
@@ -281,21 +653,50 @@ public:
     {
         if (index >= mCapacity)
         {
-            grow(index*2);
+            grow(index*2 + 1);
+        }
+    }
+
+    /**
+     * Makes sure the bag can hold the given number of elements without growing.
+     * Use it at load time so that adding elements during a frame never reallocates.
+     *
+     * @param capacity number of elements the bag must be able to hold.
+     */
+    void reserve(size_t capacity)
+    {
+        grow(capacity);
+    }
+
+    /**
+     * With incremental growth the bag starts relocating into a larger storage when
+     * it gets three quarters full, copying a few elements on each add or set, so
+     * that no single insert pays for copying the whole bag. A set() past the end of
+     * the storage still grows at once. Mutable access to the elements through get(),
+     * operator[], begin() or end() completes the relocation at once as well. Only
+     * copyable element types grow incrementally.
+     *
+     * @param incremental true to grow incrementally, false to grow when full (default).
+     */
+    void setIncrementalGrowth(bool incremental)
+    {
+        if (!incremental)
+        {
+            finishMigration();
         }
+        mIncremental = incremental && BagCopier<E>::enabled;
     }
 
     /**
      * Removes all of the elements from this bag. The bag will be empty after
-     * this call returns.
+     * this call returns. Only the slots in use are touched.
      */
     void clear()
     {
-        // null all elements so gc can clean up
-        std::memset(mData, 0, sizeof(E*)*mCapacity);
-// 		for (size_t i = 0; i < size; i++) {
-// 			data[i] = nullptr;
-// 		}
+        for (size_t i = 0; i < mSize; ++i)
+        {
+            store(i, E());
+        }
 
         mSize = 0;
     }
@@ -304,13 +705,12 @@ public:
      * Add all items into this bag.
      * @param added
      */
-    void addAll(const Bag<E*> &items)
+    void addAll(const Bag<E> &items)
     {
-    	for (int i = 0; items.size() > i; ++i) {
+    	for (size_t i = 0; items.size() > i; ++i) {
     		add(items.get(i));
     	}
     }
-    //*/
 };
 }
 #endif // Artemis_Bag_h__
@@ -0,0 +1,139 @@
+#ifndef Artemis_BitStream_h__
+#define Artemis_BitStream_h__
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace artemis
+{
+
+/**
+ * Appends values to a byte buffer bit by bit, least significant bit first.
+ * Integers are written as variable-length groups of 7 bits.
+ */
+class BitWriter
+{
+private:
+   std::vector<uint8_t> *mOut;
+   uint64_t mBits;
+   unsigned mCount;
+
+public:
+   BitWriter(std::vector<uint8_t> *out): mOut(out), mBits(0), mCount(0) {}
+
+   void writeBits(uint64_t value, unsigned bits)
+   {
+      while (bits > 0) {
+         unsigned n = bits < 32 ? bits : 32;
+         mBits |= (value & ((uint64_t(1) << n) - 1)) << mCount;
+         mCount += n;
+         value >>= n;
+         bits -= n;
+         while (mCount >= 8) {
+            mOut->push_back(static_cast<uint8_t>(mBits));
+            mBits >>= 8;
+            mCount -= 8;
+         }
+      }
+   }
+
+   void writeBit(bool bit) { writeBits(bit ? 1 : 0, 1); }
+
+   void writeVarint(uint64_t value)
+   {
+      while (value >= 0x80) {
+         writeBits((value & 0x7f) | 0x80, 8);
+         value >>= 7;
+      }
+      writeBits(value, 8);
+   }
+
+   void writeSigned(int64_t value)
+   {
+      writeVarint((static_cast<uint64_t>(value) << 1) ^ static_cast<uint64_t>(value >> 63));
+   }
+
+   /**
+    * Writes the bits left over, padded with zeros to a whole byte.
+    */
+   void flush()
+   {
+      if (mCount > 0)
+         mOut->push_back(static_cast<uint8_t>(mBits));
+      mBits = 0;
+      mCount = 0;
+   }
+};
+
+/**
+ * Reads what a BitWriter wrote. Reading past the end yields zeros and sets the
+ * overflow flag.
+ */
+class BitReader
+{
+private:
+   const uint8_t *mData;
+   size_t mSize;
+   size_t mPos;
+   uint64_t mBits;
+   unsigned mCount;
+   bool mOverflow;
+
+public:
+   BitReader(const uint8_t *data, size_t size): mData(data), mSize(size), mPos(0), mBits(0), mCount(0), mOverflow(false) {}
+
+   uint64_t readBits(unsigned bits)
+   {
+      uint64_t value = 0;
+      unsigned shift = 0;
+      while (bits > 0) {
+         if (mCount == 0) {
+            if (mPos < mSize) {
+               mBits = mData[mPos++];
+            }
+            else {
+               mBits = 0;
+               mOverflow = true;
+            }
+            mCount = 8;
+         }
+         unsigned n = bits < mCount ? bits : mCount;
+         value |= (mBits & ((uint64_t(1) << n) - 1)) << shift;
+         mBits >>= n;
+         mCount -= n;
+         shift += n;
+         bits -= n;
+      }
+      return value;
+   }
+
+   bool readBit() { return readBits(1) != 0; }
+
+   uint64_t readVarint()
+   {
+      uint64_t value = 0;
+      for (unsigned shift = 0; shift < 64; shift += 7) {
+         uint64_t group = readBits(8);
+         value |= (group & 0x7f) << shift;
+         if (!(group & 0x80))
+            return value;
+      }
+      mOverflow = true;
+      return value;
+   }
+
+   int64_t readSigned()
+   {
+      uint64_t value = readVarint();
+      return static_cast<int64_t>(value >> 1) ^ -static_cast<int64_t>(value & 1);
+   }
+
+   /**
+    * @return true if a read went past the end of the data or hit a malformed varint.
+    */
+   bool hasOverflowed() const { return mOverflow; }
+};
+
+}
+#endif // Artemis_BitStream_h__
@@ -0,0 +1,77 @@
+#include "artemis/utils/ChangeTracker.h"
+#include "artemis/ComponentManager.h"
+#include <algorithm>
+
+namespace artemis
+{
+
+void ChangeTracker::attach(ComponentManager *manager, const std::bitset<64> &types)
+{
+   detach();
+   mManager = manager;
+   mTypes = types;
+   manager->addChangeTracker(this);
+
+   for (ComponentType t = 0; t < 64; ++t) {
+      if (!types.test(t))
+         continue;
+      Bag<Component *> *components = manager->getComponentsByType(t);
+      for (size_t id = 0; id < components->size(); ++id) {
+         if (components->get(id) != nullptr)
+            mark(t, static_cast<int>(id));
+      }
+   }
+}
+
+void ChangeTracker::detach()
+{
+   if (mManager != nullptr)
+      mManager->removeChangeTracker(this);
+   mManager = nullptr;
+   clear();
+}
+
+void ChangeTracker::sort()
+{
+   for (ComponentType t = 0; t < 64; ++t) {
+      if (mChanged[t].size() > 1)
+         std::sort(mChanged[t].begin(), mChanged[t].end());
+   }
+}
+
+void ChangeTracker::clear()
+{
+   for (ComponentType t = 0; t < 64; ++t) {
+      std::vector<int> &changed = mChanged[t];
+      std::vector<uint64_t> &marked = mMarked[t];
+      for (size_t i = 0; i < changed.size(); ++i) {
+         marked[changed[i] >> 6] = 0;
+      }
+      changed.clear();
+   }
+   mDeleted.clear();
+}
+
+void ChangeTracker::reserve(size_t entities)
+{
+   size_t words = (entities + 63) / 64;
+   for (ComponentType t = 0; t < 64; ++t) {
+      if (!mTypes.test(t))
+         continue;
+      if (mMarked[t].size() < words)
+         mMarked[t].resize(words, 0);
+      mChanged[t].reserve(entities);
+   }
+   mDeleted.reserve(entities);
+}
+
+void ChangeTracker::reportMemory(MemoryUsage &usage) const
+{
+   for (ComponentType t = 0; t < 64; ++t) {
+      usage.add(mMarked[t].size() * sizeof(uint64_t), mMarked[t].capacity() * sizeof(uint64_t));
+      usage.add(mChanged[t].size() * sizeof(int), mChanged[t].capacity() * sizeof(int));
+   }
+   usage.add(mDeleted.size() * sizeof(int), mDeleted.capacity() * sizeof(int));
+}
+
+}
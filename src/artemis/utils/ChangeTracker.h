@@ -0,0 +1,98 @@
+#ifndef Artemis_ChangeTracker_h__
+#define Artemis_ChangeTracker_h__
+
+#include "artemis/ComponentType.h"
+#include "artemis/utils/MemoryReport.h"
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace artemis
+{
+class ComponentManager;
+
+/**
+ * Collects the ids of the entities whose components of some types may have
+ * changed, so that consumers such as rollback and replication only look at those
+ * instead of walking all the storage of their types.
+ *
+ * Once attached, the component manager marks a component when it is added or
+ * removed, when its entity is added to or deleted from the world, and when it is
+ * written through ComponentMapper.edit() or Entity.editComponent(). Changes made
+ * through a plain get() are not seen. Each consumer has its own tracker and clears
+ * it once it has handled the changes.
+ */
+class ChangeTracker
+{
+   friend class ComponentManager;
+private:
+   ComponentManager *mManager;
+   std::bitset<64> mTypes;
+   std::vector<uint64_t> mMarked[64]; // a bit per entity id
+   std::vector<int> mChanged[64];
+   std::vector<int> mDeleted;
+
+   void mark(ComponentType type, int id)
+   {
+      std::vector<uint64_t> &marked = mMarked[type];
+      size_t word = static_cast<size_t>(id) >> 6;
+      uint64_t bit = uint64_t(1) << (id & 63);
+      if (word >= marked.size())
+         marked.resize(word + 1, 0);
+      if (!(marked[word] & bit)) {
+         marked[word] |= bit;
+         mChanged[type].push_back(id);
+      }
+   }
+
+   void markDeleted(int id) { mDeleted.push_back(id); }
+
+   ChangeTracker(const ChangeTracker &) = delete;
+   ChangeTracker & operator=(const ChangeTracker &) = delete;
+
+public:
+   ChangeTracker(): mManager(nullptr) {}
+   ~ChangeTracker() { detach(); }
+
+   /**
+    * Starts tracking component types. The components of those types that exist
+    * already are marked, so they are seen once as changes.
+    */
+   void attach(ComponentManager *manager, const std::bitset<64> &types);
+   void detach();
+
+   const std::bitset<64> & getTypes() const { return mTypes; }
+
+   /**
+    * @return ids of the entities whose component of a type may have changed
+    *         since the last clear(), in the order they were marked unless sorted.
+    */
+   const std::vector<int> & getChanged(ComponentType type) const { return mChanged[type]; }
+
+   /**
+    * @return ids of the entities deleted since the last clear(), which may repeat
+    *         if ids were reused.
+    */
+   const std::vector<int> & getDeleted() const { return mDeleted; }
+
+   /**
+    * Sorts the changed ids of every type in ascending order.
+    */
+   void sort();
+
+   /**
+    * Forgets the changes, resetting only what was marked.
+    */
+   void clear();
+
+   /**
+    * Presizes the marks for entity ids below the given count.
+    */
+   void reserve(size_t entities);
+
+   void reportMemory(MemoryUsage &usage) const;
+};
+
+}
+#endif // Artemis_ChangeTracker_h__
@@ -0,0 +1,51 @@
+#include "artemis/utils/ChurnCounters.h"
+#include <cstring>
+
+namespace artemis
+{
+
+ChurnCounters::ChurnCounters()
+{
+   reset();
+}
+
+void ChurnCounters::endFrame()
+{
+   for (size_t i = 0; i < MAX_TYPES; ++i) {
+      mTotal.componentAdds[i] += mCurrent.componentAdds[i];
+      mTotal.componentRemoves[i] += mCurrent.componentRemoves[i];
+      mTotal.systemInserts[i] += mCurrent.systemInserts[i];
+      mTotal.systemRemoves[i] += mCurrent.systemRemoves[i];
+   }
+   mTotal.checks += mCurrent.checks;
+   mTotal.bagGrowths += mCurrent.bagGrowths;
+   mFrames++;
+
+   mLast = mCurrent;
+   std::memset(&mCurrent, 0, sizeof(Frame));
+}
+
+void ChurnCounters::reset()
+{
+   std::memset(&mCurrent, 0, sizeof(Frame));
+   std::memset(&mLast, 0, sizeof(Frame));
+   std::memset(&mTotal, 0, sizeof(Frame));
+   mFrames = 0;
+}
+
+void ChurnCounters::print(const Frame &frame, std::ostream &out)
+{
+   out << "checks: " << frame.checks << ", bag growths: " << frame.bagGrowths << '\n';
+   for (size_t i = 0; i < MAX_TYPES; ++i) {
+      if (frame.componentAdds[i] > 0 || frame.componentRemoves[i] > 0) {
+         out << "  component " << i << ": +" << frame.componentAdds[i] << " -" << frame.componentRemoves[i] << '\n';
+      }
+   }
+   for (size_t i = 0; i < MAX_TYPES; ++i) {
+      if (frame.systemInserts[i] > 0 || frame.systemRemoves[i] > 0) {
+         out << "  system " << i << ": +" << frame.systemInserts[i] << " -" << frame.systemRemoves[i] << '\n';
+      }
+   }
+}
+
+}
@@ -0,0 +1,94 @@
+#ifndef Artemis_ChurnCounters_h__
+#define Artemis_ChurnCounters_h__
+
+#include "artemis/ComponentType.h"
+#include "artemis/EntitySystemType.h"
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace artemis
+{
+
+/**
+ * Counts structural changes: components added and removed per type, entities
+ * inserted into and removed from each system, EntitySystem.check() evaluations and
+ * Bag growths. A frame covers everything since the end of the previous
+ * World.process() up to the end of the current one, so changes made between frames
+ * count for the next frame. Enable them with World.enableChurnCounters().
+ */
+class ChurnCounters
+{
+public:
+   static const size_t MAX_TYPES = 64;
+
+   struct Frame
+   {
+      uint64_t componentAdds[MAX_TYPES];
+      uint64_t componentRemoves[MAX_TYPES];
+      uint64_t systemInserts[MAX_TYPES];
+      uint64_t systemRemoves[MAX_TYPES];
+      uint64_t checks;
+      uint64_t bagGrowths;
+   };
+
+   /**
+    * A distinct set of components and the number of entities that have exactly those.
+    */
+   struct Archetype
+   {
+      std::bitset<64> componentBits;
+      size_t population;
+   };
+
+private:
+   Frame mCurrent;
+   Frame mLast;
+   Frame mTotal;
+   uint64_t mFrames;
+
+   ChurnCounters(const ChurnCounters &) = delete;
+   ChurnCounters & operator=(const ChurnCounters &) = delete;
+
+public:
+   ChurnCounters();
+
+   // Called by ComponentManager, EntitySystem, World and EntityFile.
+   void componentAdded(ComponentType type) { if (type < MAX_TYPES) mCurrent.componentAdds[type]++; }
+   void componentsAdded(ComponentType type, uint64_t count) { if (type < MAX_TYPES) mCurrent.componentAdds[type] += count; }
+   void componentRemoved(ComponentType type) { if (type < MAX_TYPES) mCurrent.componentRemoves[type]++; }
+   void systemInserted(EntitySystemType type) { if (type < MAX_TYPES) mCurrent.systemInserts[type]++; }
+   void systemRemoved(EntitySystemType type) { if (type < MAX_TYPES) mCurrent.systemRemoves[type]++; }
+   void checked() { mCurrent.checks++; }
+   uint64_t * getBagGrowthCounter() { return &mCurrent.bagGrowths; }
+   void endFrame();
+
+   /**
+    * @return the counts of the last processed frame.
+    */
+   const Frame & getLastFrame() const { return mLast; }
+
+   /**
+    * @return the counts summed since the last reset().
+    */
+   const Frame & getTotal() const { return mTotal; }
+
+   /**
+    * @return frames processed since the last reset().
+    */
+   uint64_t getFrameCount() const { return mFrames; }
+
+   /**
+    * Clears all counts.
+    */
+   void reset();
+
+   /**
+    * Writes the non-zero counts of a frame.
+    */
+   static void print(const Frame &frame, std::ostream &out);
+};
+
+}
+#endif // Artemis_ChurnCounters_h__
@@ -0,0 +1,378 @@
+#include "artemis/utils/CommandJournal.h"
+#include "artemis/Aspect.h"
+#include "artemis/ComponentCodec.h"
+#include "artemis/ComponentManager.h"
+#include "artemis/Entity.h"
+#include "artemis/World.h"
+#include <cstring>
+
+namespace artemis
+{
+
+namespace
+{
+
+const char JOURNAL_MAGIC[8] = { 'A', 'R', 'T', 'J', 'R', 'N', 'L', 0 };
+const uint32_t JOURNAL_VERSION = 1;
+const size_t HEADER_SIZE = 16;
+
+}
+
+CommandJournal::CommandJournal(World *world): mWorld(world), mLength(0), mCommandCount(0)
+{
+}
+
+CommandJournal::~CommandJournal()
+{
+   if (mFile.isOpen()) {
+      mFile.resize(mLength);
+      mFile.close();
+   }
+}
+
+bool CommandJournal::open(const std::string &path, size_t capacity)
+{
+   mLength = 0;
+   mCommandCount = 0;
+   if (!mFile.openWrite(path, capacity > HEADER_SIZE * 2 ? capacity : HEADER_SIZE * 2))
+      return false;
+   std::memcpy(mFile.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+   std::memcpy(mFile.data() + sizeof(JOURNAL_MAGIC), &JOURNAL_VERSION, sizeof(JOURNAL_VERSION));
+   mLength = HEADER_SIZE;
+   return true;
+}
+
+bool CommandJournal::reserve(size_t bytes)
+{
+   if (mLength + bytes < mFile.size())
+      return true;
+   size_t size = mFile.size() * 2;
+   while (size <= mLength + bytes)
+      size *= 2;
+   return mFile.resize(size);
+}
+
+void CommandJournal::writeVarint(uint64_t value)
+{
+   char *out = mFile.data() + mLength;
+   while (value >= 0x80) {
+      *out++ = static_cast<char>((value & 0x7f) | 0x80);
+      value >>= 7;
+   }
+   *out++ = static_cast<char>(value);
+   mLength = out - mFile.data();
+}
+
+void CommandJournal::record(int command, Entity *e)
+{
+   if (!mFile.isOpen() || !reserve(16))
+      return;
+   mFile.data()[mLength++] = static_cast<char>(command | (mWorld->isProcessing() ? IN_PROCESS : 0));
+   writeVarint(static_cast<uint32_t>(e->getId()));
+   mCommandCount++;
+}
+
+void CommandJournal::recordComponent(Entity *e, Component *component)
+{
+   const ComponentCodec *codec = mWorld->getComponentManager()->getComponentCodec(component->getType());
+   size_t size = codec != nullptr ? codec->size : 0;
+   if (!mFile.isOpen() || !reserve(32 + size))
+      return;
+   mFile.data()[mLength++] = static_cast<char>(cmAddComponent | (mWorld->isProcessing() ? IN_PROCESS : 0));
+   writeVarint(static_cast<uint32_t>(e->getId()));
+   writeVarint(component->getType());
+   writeVarint(size);
+   if (size > 0) {
+      codec->save(component, mFile.data() + mLength);
+      mLength += size;
+   }
+   mCommandCount++;
+}
+
+void CommandJournal::recordRemoveComponent(Entity *e, ComponentType type)
+{
+   if (!mFile.isOpen() || !reserve(24))
+      return;
+   mFile.data()[mLength++] = static_cast<char>(cmRemoveComponent | (mWorld->isProcessing() ? IN_PROCESS : 0));
+   writeVarint(static_cast<uint32_t>(e->getId()));
+   writeVarint(type);
+   mCommandCount++;
+}
+
+void CommandJournal::recordDelta(float delta)
+{
+   if (!mFile.isOpen() || !reserve(8))
+      return;
+   mFile.data()[mLength++] = static_cast<char>(cmSetDelta | (mWorld->isProcessing() ? IN_PROCESS : 0));
+   std::memcpy(mFile.data() + mLength, &delta, sizeof(float));
+   mLength += sizeof(float);
+   mCommandCount++;
+}
+
+void CommandJournal::recordProcess()
+{
+   if (!mFile.isOpen() || !reserve(1))
+      return;
+   mFile.data()[mLength++] = static_cast<char>(cmProcess);
+   mCommandCount++;
+}
+
+void CommandJournal::recordBulkOperation(int command, const Aspect *aspect, ComponentType type, const Component *prototype)
+{
+   const ComponentCodec *codec = prototype != nullptr ? mWorld->getComponentManager()->getComponentCodec(type) : nullptr;
+   size_t size = codec != nullptr ? codec->size : 0;
+   if (!mFile.isOpen() || !reserve(64 + size))
+      return;
+   mFile.data()[mLength++] = static_cast<char>(command | (mWorld->isProcessing() ? IN_PROCESS : 0));
+   writeVarint(aspect->allSet.to_ullong());
+   writeVarint(aspect->exclusionSet.to_ullong());
+   writeVarint(aspect->oneSet.to_ullong());
+   if (command == cmAddComponentToAll || command == cmRemoveComponentFromAll)
+      writeVarint(type);
+   if (command == cmAddComponentToAll) {
+      writeVarint(size);
+      if (size > 0) {
+         codec->save(prototype, mFile.data() + mLength);
+         mLength += size;
+      }
+   }
+   mCommandCount++;
+}
+
+const char * CommandJournal::getCommandName(int command)
+{
+   static const char *names[cmCOMMANDS_CNT] = {
+      "end",
+      "createEntity",
+      "addToWorld",
+      "addComponent",
+      "removeComponent",
+      "changedInWorld",
+      "deleteFromWorld",
+      "enable",
+      "disable",
+      "setDelta",
+      "process",
+      "deleteAll",
+      "addComponentToAll",
+      "removeComponentFromAll",
+      "disableAll"
+   };
+   command &= ~IN_PROCESS;
+   return command >= 0 && command < cmCOMMANDS_CNT ? names[command] : "unknown";
+}
+
+JournalReplayer::JournalReplayer(World *world): mWorld(world), mPosition(0), mFrames(0), mCommands(0), mSkippedComponents(0), mFailed(false)
+{
+}
+
+bool JournalReplayer::open(const std::string &path)
+{
+   if (!mFile.openRead(path) || mFile.size() < HEADER_SIZE)
+      return false;
+   uint32_t version;
+   std::memcpy(&version, mFile.data() + sizeof(JOURNAL_MAGIC), sizeof(version));
+   if (std::memcmp(mFile.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 || version != JOURNAL_VERSION) {
+      mFile.close();
+      return false;
+   }
+   mPosition = HEADER_SIZE;
+   return true;
+}
+
+bool JournalReplayer::readVarint(uint64_t &value)
+{
+   value = 0;
+   for (unsigned shift = 0; shift < 64 && mPosition < mFile.size(); shift += 7) {
+      uint8_t byte = static_cast<uint8_t>(mFile.data()[mPosition++]);
+      value |= uint64_t(byte & 0x7f) << shift;
+      if (!(byte & 0x80))
+         return true;
+   }
+   return false;
+}
+
+Entity * JournalReplayer::getEntity(uint64_t id)
+{
+   if (id < mEntities.size() && mEntities[id] != nullptr)
+      return mEntities[id];
+   return mWorld->getEntity(static_cast<int>(id));
+}
+
+bool JournalReplayer::replayBulkOperation(int command, bool skip)
+{
+   uint64_t all, exclusion, one, type = 0, size = 0;
+   if (!readVarint(all) || !readVarint(exclusion) || !readVarint(one))
+      return false;
+   if (command == CommandJournal::cmAddComponentToAll || command == CommandJournal::cmRemoveComponentFromAll) {
+      if (!readVarint(type) || type >= 64)
+         return false;
+   }
+   if (command == CommandJournal::cmAddComponentToAll) {
+      if (!readVarint(size) || size > mFile.size() - mPosition)
+         return false;
+   }
+   const char *data = mFile.data() + mPosition;
+   mPosition += size;
+   if (skip)
+      return true;
+
+   Aspect *aspect = Aspect::getEmpty();
+   aspect->allSet = std::bitset<64>(all);
+   aspect->exclusionSet = std::bitset<64>(exclusion);
+   aspect->oneSet = std::bitset<64>(one);
+   switch (command) {
+   case CommandJournal::cmDeleteAll:
+      mWorld->deleteAll(aspect);
+      break;
+   case CommandJournal::cmAddComponentToAll: {
+      const ComponentCodec *codec = mWorld->getComponentManager()->getComponentCodec(static_cast<ComponentType>(type));
+      if (codec == nullptr || codec->size != size) {
+         mSkippedComponents++;
+         delete aspect;
+         break;
+      }
+      Component *prototype = codec->create();
+      codec->load(prototype, data);
+      mWorld->queueBulkOperation(CommandJournal::cmAddComponentToAll, aspect, static_cast<ComponentType>(type), prototype, nullptr);
+      break;
+   }
+   case CommandJournal::cmRemoveComponentFromAll:
+      mWorld->removeComponentFromAll(aspect, static_cast<ComponentType>(type));
+      break;
+   case CommandJournal::cmDisableAll:
+      mWorld->disableAll(aspect);
+      break;
+   }
+   return true;
+}
+
+bool JournalReplayer::isAtEnd() const
+{
+   return mFailed || mPosition >= mFile.size() || mFile.data()[mPosition] == CommandJournal::cmEnd;
+}
+
+uint64_t JournalReplayer::step(uint64_t frames)
+{
+   uint64_t processed = 0;
+   while (processed < frames && !isAtEnd()) {
+      uint8_t op = static_cast<uint8_t>(mFile.data()[mPosition++]);
+      bool skip = (op & CommandJournal::IN_PROCESS) != 0;
+      int command = op & ~CommandJournal::IN_PROCESS;
+      mCommands++;
+
+      if (command == CommandJournal::cmProcess) {
+         mWorld->process();
+         // Entities added by now are found through the world.
+         for (size_t id = 0; id < mEntities.size(); ++id) {
+            if (mEntities[id] != nullptr && mWorld->getEntity(static_cast<int>(id)) == mEntities[id])
+               mEntities[id] = nullptr;
+         }
+         mFrames++;
+         processed++;
+         continue;
+      }
+      if (command >= CommandJournal::cmDeleteAll && command <= CommandJournal::cmDisableAll) {
+         if (!replayBulkOperation(command, skip)) {
+            mFailed = true;
+            break;
+         }
+         continue;
+      }
+      if (command == CommandJournal::cmSetDelta) {
+         float delta;
+         if (mPosition + sizeof(float) > mFile.size()) {
+            mFailed = true;
+            break;
+         }
+         std::memcpy(&delta, mFile.data() + mPosition, sizeof(float));
+         mPosition += sizeof(float);
+         if (!skip)
+            mWorld->setDelta(delta);
+         continue;
+      }
+
+      uint64_t id, type = 0, size = 0;
+      if (!readVarint(id)) {
+         mFailed = true;
+         break;
+      }
+      if (command == CommandJournal::cmAddComponent) {
+         if (!readVarint(type) || !readVarint(size) || size > mFile.size() - mPosition) {
+            mFailed = true;
+            break;
+         }
+      }
+      else if (command == CommandJournal::cmRemoveComponent) {
+         if (!readVarint(type)) {
+            mFailed = true;
+            break;
+         }
+      }
+      const char *data = mFile.data() + mPosition;
+      mPosition += size;
+      if (skip)
+         continue;
+
+      if (command == CommandJournal::cmCreateEntity) {
+         Entity *e = mWorld->createEntity();
+         if (id >= mEntities.size())
+            mEntities.resize(id + 1, nullptr);
+         mEntities[id] = e;
+         continue;
+      }
+
+      Entity *e = getEntity(id);
+      if (e == nullptr || command >= CommandJournal::cmCOMMANDS_CNT) {
+         mFailed = true;
+         break;
+      }
+      switch (command) {
+      case CommandJournal::cmAddToWorld:
+         e->addToWorld();
+         break;
+      case CommandJournal::cmAddComponent: {
+         const ComponentCodec *codec = type < 64 ? mWorld->getComponentManager()->getComponentCodec(static_cast<ComponentType>(type)) : nullptr;
+         if (codec == nullptr || codec->size != size) {
+            mSkippedComponents++;
+            break;
+         }
+         Component *component = codec->create();
+         codec->load(component, data);
+         e->addComponent(component);
+         break;
+      }
+      case CommandJournal::cmRemoveComponent:
+         e->removeComponent(static_cast<ComponentType>(type));
+         break;
+      case CommandJournal::cmChangedInWorld:
+         e->changedInWorld();
+         break;
+      case CommandJournal::cmDeleteFromWorld:
+         e->deleteFromWorld();
+         if (id < mEntities.size())
+            mEntities[id] = nullptr;
+         break;
+      case CommandJournal::cmEnable:
+         e->enable();
+         break;
+      case CommandJournal::cmDisable:
+         e->disable();
+         break;
+      default:
+         mFailed = true;
+         break;
+      }
+   }
+   return processed;
+}
+
+bool JournalReplayer::replay()
+{
+   while (!isAtEnd()) {
+      step(UINT64_MAX);
+   }
+   return !mFailed;
+}
+
+}
@@ -0,0 +1,151 @@
+#ifndef Artemis_CommandJournal_h__
+#define Artemis_CommandJournal_h__
+
+#include "artemis/ComponentType.h"
+#include "artemis/utils/MappedFile.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace artemis
+{
+class Aspect;
+class Component;
+class Entity;
+class World;
+
+/**
+ * Appends every structural command issued on a world to a memory-mapped file:
+ * entity creation, addToWorld, component adds and removes, changedInWorld,
+ * deleteFromWorld, enable, disable, setDelta, each World.process() and the bulk
+ * operations of World, such as deleteAll(), with their aspect. A command
+ * is an opcode byte and variable-length integers written straight into the
+ * mapping, so the journal can stay on in production; after a crash the pages
+ * written so far are still in the file.
+ *
+ * Added components carry their data as of the call for types registered with
+ * World.registerComponent(), other types only their type. Commands issued by
+ * systems while the world is processing are marked, a replay skips them since
+ * the systems issue them again. Enable it with World.enableJournal().
+ */
+class CommandJournal
+{
+public:
+   enum Commands {
+      cmEnd = 0, // unwritten space reads as the end of the journal
+      cmCreateEntity,
+      cmAddToWorld,
+      cmAddComponent,
+      cmRemoveComponent,
+      cmChangedInWorld,
+      cmDeleteFromWorld,
+      cmEnable,
+      cmDisable,
+      cmSetDelta,
+      cmProcess,
+      cmDeleteAll,
+      cmAddComponentToAll,
+      cmRemoveComponentFromAll,
+      cmDisableAll,
+      cmCOMMANDS_CNT
+   };
+
+   static const uint8_t IN_PROCESS = 0x80;
+
+private:
+   World *mWorld;
+   MappedFile mFile;
+   size_t mLength;
+   uint64_t mCommandCount;
+
+   bool reserve(size_t bytes);
+   void writeVarint(uint64_t value);
+
+   CommandJournal(const CommandJournal &) = delete;
+   CommandJournal & operator=(const CommandJournal &) = delete;
+
+public:
+   CommandJournal(World *world);
+
+   /**
+    * Truncates the file to the commands written.
+    */
+   ~CommandJournal();
+
+   /**
+    * Creates or truncates the journal file.
+    *
+    * @param capacity bytes mapped up front, the file doubles when they run out.
+    */
+   bool open(const std::string &path, size_t capacity);
+
+   void record(int command, Entity *e);
+   void recordComponent(Entity *e, Component *component);
+   void recordRemoveComponent(Entity *e, ComponentType type);
+   void recordDelta(float delta);
+   void recordProcess();
+   void recordBulkOperation(int command, const Aspect *aspect, ComponentType type, const Component *prototype);
+
+   /**
+    * @return bytes written, including the header.
+    */
+   size_t getLength() const { return mLength; }
+
+   uint64_t getCommandCount() const { return mCommandCount; }
+
+   static const char * getCommandName(int command);
+};
+
+/**
+ * Drives a world from a journal as fast as it goes: the world should be set up
+ * like the journaled one, with the same systems, managers and component
+ * registrations, and no entities.
+ */
+class JournalReplayer
+{
+private:
+   World *mWorld;
+   MappedFile mFile;
+   size_t mPosition;
+   std::vector<Entity *> mEntities; // replayed entity per journaled id
+   uint64_t mFrames;
+   uint64_t mCommands;
+   uint64_t mSkippedComponents;
+   bool mFailed;
+
+   bool readVarint(uint64_t &value);
+   Entity * getEntity(uint64_t id);
+   bool replayBulkOperation(int command, bool skip);
+
+public:
+   JournalReplayer(World *world);
+
+   bool open(const std::string &path);
+
+   /**
+    * Replays commands up to and including the given number of World.process() calls.
+    *
+    * @return number of frames processed, fewer at the end of the journal.
+    */
+   uint64_t step(uint64_t frames);
+
+   /**
+    * Replays the whole journal.
+    *
+    * @return false if the journal is malformed or refers to unknown entities.
+    */
+   bool replay();
+
+   bool isAtEnd() const;
+   bool hasFailed() const { return mFailed; }
+   uint64_t getFrameCount() const { return mFrames; }
+   uint64_t getCommandCount() const { return mCommands; }
+
+   /**
+    * @return added components that could not be replayed, their type not being registered.
+    */
+   uint64_t getSkippedComponentCount() const { return mSkippedComponents; }
+};
+
+}
+#endif // Artemis_CommandJournal_h__
@@ -0,0 +1,251 @@
+#include "artemis/utils/EntityFile.h"
+#include "artemis/ComponentCodec.h"
+#include "artemis/ComponentManager.h"
+#include "artemis/Entity.h"
+#include "artemis/EntityManager.h"
+#include "artemis/World.h"
+#include "artemis/utils/MappedFile.h"
+#include <cstdio>
+#include <cstring>
+
+namespace artemis
+{
+
+namespace
+{
+
+const char ENTITY_FILE_MAGIC[8] = { 'A', 'R', 'T', 'E', 'N', 'T', 'S', 0 };
+
+size_t align8(size_t n)
+{
+   return (n + 7) & ~size_t(7);
+}
+
+}
+
+bool EntityFile::Chunk::parse(World *world, const char *data, size_t size)
+{
+   mHeader = nullptr;
+   mNext = 0;
+   mTypes = 0;
+   if (size < sizeof(ChunkHeader))
+      return false;
+   const ChunkHeader *header = reinterpret_cast<const ChunkHeader *>(data);
+   if (header->size > size - sizeof(ChunkHeader))
+      return false;
+   const char *in = data + sizeof(ChunkHeader);
+   const char *end = in + header->size;
+
+   size_t n = header->entityCount;
+   if (n * sizeof(uint64_t) + align8(n * sizeof(uint32_t)) > header->size)
+      return false;
+   mBits = reinterpret_cast<const uint64_t *>(in);
+   in += n * sizeof(uint64_t);
+   mDisabled = reinterpret_cast<const uint32_t *>(in);
+   in += align8(n * sizeof(uint32_t));
+
+   uint64_t counts[64] = {};
+   for (size_t i = 0; i < n; ++i) {
+      for (size_t t = 0; t < 64; ++t) {
+         if (mBits[i] & (uint64_t(1) << t))
+            counts[t]++;
+      }
+   }
+
+   ComponentManager *cm = world->getComponentManager();
+   for (uint32_t i = 0; i < header->typeCount; ++i) {
+      if (in > end || size_t(end - in) < sizeof(TypeHeader))
+         return false;
+      const TypeHeader *type = reinterpret_cast<const TypeHeader *>(in);
+      in += sizeof(TypeHeader);
+      const ComponentCodec *codec = type->type < 64 ? cm->getComponentCodec(type->type) : nullptr;
+      if (codec == nullptr || codec->size != type->dataSize || counts[type->type] != type->count)
+         return false;
+      if (type->dataSize > 0 && type->count > size_t(end - in) / type->dataSize)
+         return false;
+      mData[type->type] = in;
+      mDataSize[type->type] = type->dataSize;
+      mTypes |= uint64_t(1) << type->type;
+      counts[type->type] = 0;
+      in += align8(type->count * type->dataSize);
+   }
+   for (size_t t = 0; t < 64; ++t) {
+      if (counts[t] != 0)
+         return false;
+   }
+   mHeader = header;
+   return true;
+}
+
+size_t EntityFile::Chunk::commit(World *world, size_t max, std::vector<Entity *> *created)
+{
+   size_t n = getRemaining();
+   if (n > max)
+      n = max;
+   if (n == 0)
+      return 0;
+
+   mCreated.resize(n);
+   world->createEntities(mCreated.data(), n);
+   int last = mCreated[n - 1]->getId();
+
+   ComponentManager *cm = world->getComponentManager();
+   ChurnCounters *churn = world->getChurnCounters();
+   for (size_t t = 0; t < 64; ++t) {
+      if (!(mTypes & (uint64_t(1) << t)))
+         continue;
+      const ComponentCodec *codec = cm->getComponentCodec(t);
+      Bag<Component *> *components = cm->getComponentsByType(t);
+      components->ensureCapacity(last);
+      uint64_t bit = uint64_t(1) << t;
+      uint64_t added = 0;
+      for (size_t i = 0; i < n; ++i) {
+         if (mBits[mNext + i] & bit) {
+            Component *component = codec->create();
+            codec->load(component, mData[t]);
+            mData[t] += mDataSize[t];
+            components->set(mCreated[i]->getId(), component);
+            added++;
+         }
+      }
+      if (churn)
+         churn->componentsAdded(t, added);
+   }
+
+   CommandJournal *journal = world->getJournal();
+   for (size_t i = 0; i < n; ++i) {
+      Entity *e = mCreated[i];
+      e->getComponentBits() = std::bitset<64>(mBits[mNext + i]);
+      if (journal) {
+         for (size_t t = 0; t < 64; ++t) {
+            if (mBits[mNext + i] & (uint64_t(1) << t))
+               journal->recordComponent(e, cm->getComponentsByType(t)->get(e->getId()));
+         }
+      }
+      world->addEntity(e);
+      if (mDisabled[mNext + i])
+         world->disable(e);
+   }
+   if (created != nullptr)
+      created->insert(created->end(), mCreated.begin(), mCreated.end());
+   mNext += n;
+   return n;
+}
+
+bool EntityFile::write(World *world, Entity *const *entities, size_t count, const std::string &path, size_t entitiesPerChunk)
+{
+   if (entitiesPerChunk == 0)
+      entitiesPerChunk = 1024;
+   std::FILE *file = std::fopen(path.c_str(), "wb");
+   if (file == nullptr)
+      return false;
+
+   Header header;
+   std::memset(&header, 0, sizeof(Header));
+   std::memcpy(header.magic, ENTITY_FILE_MAGIC, sizeof(ENTITY_FILE_MAGIC));
+   header.version = VERSION;
+   header.chunkCount = static_cast<uint32_t>((count + entitiesPerChunk - 1) / entitiesPerChunk);
+   header.entityCount = count;
+   bool ok = std::fwrite(&header, sizeof(Header), 1, file) == 1;
+
+   ComponentManager *cm = world->getComponentManager();
+   std::bitset<64> savedTypes;
+   for (size_t t = 0; t < 64; ++t) {
+      if (cm->getComponentCodec(t) != nullptr)
+         savedTypes.set(t);
+   }
+
+   std::vector<char> buffer;
+   for (size_t first = 0; first < count && ok; first += entitiesPerChunk) {
+      size_t n = count - first < entitiesPerChunk ? count - first : entitiesPerChunk;
+      Entity *const *chunk = entities + first;
+
+      size_t counts[64] = {};
+      for (size_t i = 0; i < n; ++i) {
+         std::bitset<64> bits = chunk[i]->getComponentBits() & savedTypes;
+         for (size_t t = 0; t < 64; ++t) {
+            if (bits.test(t))
+               counts[t]++;
+         }
+      }
+
+      size_t size = n * sizeof(uint64_t) + align8(n * sizeof(uint32_t));
+      uint32_t typeCount = 0;
+      for (size_t t = 0; t < 64; ++t) {
+         if (counts[t] > 0) {
+            size += sizeof(TypeHeader) + align8(counts[t] * cm->getComponentCodec(t)->size);
+            typeCount++;
+         }
+      }
+      buffer.assign(sizeof(ChunkHeader) + size, 0);
+
+      ChunkHeader *chunkHeader = reinterpret_cast<ChunkHeader *>(&buffer[0]);
+      chunkHeader->entityCount = static_cast<uint32_t>(n);
+      chunkHeader->typeCount = typeCount;
+      chunkHeader->size = size;
+      char *out = &buffer[sizeof(ChunkHeader)];
+
+      uint64_t *bits = reinterpret_cast<uint64_t *>(out);
+      uint32_t *disabled = reinterpret_cast<uint32_t *>(out + n * sizeof(uint64_t));
+      for (size_t i = 0; i < n; ++i) {
+         bits[i] = (chunk[i]->getComponentBits() & savedTypes).to_ullong();
+         disabled[i] = chunk[i]->isEnabled() ? 0 : 1;
+      }
+      out += n * sizeof(uint64_t) + align8(n * sizeof(uint32_t));
+
+      for (size_t t = 0; t < 64; ++t) {
+         if (counts[t] == 0)
+            continue;
+         const ComponentCodec *codec = cm->getComponentCodec(t);
+         TypeHeader *type = reinterpret_cast<TypeHeader *>(out);
+         type->type = static_cast<uint32_t>(t);
+         type->dataSize = static_cast<uint32_t>(codec->size);
+         type->count = counts[t];
+         out += sizeof(TypeHeader);
+
+         Bag<Component *> *components = cm->getComponentsByType(t);
+         char *data = out;
+         for (size_t i = 0; i < n; ++i) {
+            if (bits[i] & (uint64_t(1) << t)) {
+               codec->save(components->get(chunk[i]->getId()), data);
+               data += codec->size;
+            }
+         }
+         out += align8(counts[t] * codec->size);
+      }
+      ok = std::fwrite(buffer.data(), buffer.size(), 1, file) == 1;
+   }
+
+   ok = std::fclose(file) == 0 && ok;
+   if (!ok)
+      std::remove(path.c_str());
+   return ok;
+}
+
+bool EntityFile::readHeader(const char *data, size_t size, Header &header)
+{
+   if (size < sizeof(Header))
+      return false;
+   std::memcpy(&header, data, sizeof(Header));
+   return std::memcmp(header.magic, ENTITY_FILE_MAGIC, sizeof(ENTITY_FILE_MAGIC)) == 0 && header.version == VERSION;
+}
+
+bool EntityFile::read(World *world, const std::string &path, std::vector<Entity *> *created)
+{
+   MappedFile file;
+   Header header;
+   if (!file.openRead(path) || !readHeader(file.data(), file.size(), header))
+      return false;
+
+   size_t offset = sizeof(Header);
+   Chunk chunk;
+   for (uint32_t i = 0; i < header.chunkCount; ++i) {
+      if (!chunk.parse(world, file.data() + offset, file.size() - offset))
+         return false;
+      offset += sizeof(ChunkHeader) + reinterpret_cast<const ChunkHeader *>(file.data() + offset)->size;
+      chunk.commit(world, chunk.getRemaining(), created);
+   }
+   return true;
+}
+
+}
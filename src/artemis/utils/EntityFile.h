@@ -0,0 +1,119 @@
+#ifndef Artemis_EntityFile_h__
+#define Artemis_EntityFile_h__
+
+#include "artemis/ComponentType.h"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace artemis
+{
+class Entity;
+class World;
+
+/**
+ * A file of entities without ids, in chunks that can be read and committed to a
+ * world one at a time. Each chunk holds the enabled state and component bits of its
+ * entities, then per component type the data of its components in entity order.
+ * Only types registered with World.registerComponent() are written.
+ *
+ * Layout, in native byte order, every part 8-byte aligned: a Header, then per chunk
+ * a ChunkHeader followed by ChunkHeader.size bytes: a uint64 component mask per
+ * entity, a uint32 disabled flag per entity, and a TypeHeader plus data per type.
+ */
+class EntityFile
+{
+public:
+   static const uint32_t VERSION = 1;
+
+   struct Header
+   {
+      char magic[8];
+      uint32_t version;
+      uint32_t chunkCount;
+      uint64_t entityCount;
+   };
+
+   struct ChunkHeader
+   {
+      uint32_t entityCount;
+      uint32_t typeCount;
+      uint64_t size;
+   };
+
+   struct TypeHeader
+   {
+      uint32_t type;
+      uint32_t dataSize;
+      uint64_t count;
+   };
+
+   /**
+    * A chunk being committed to a world, possibly over several calls.
+    */
+   class Chunk
+   {
+   private:
+      const ChunkHeader *mHeader;
+      const uint64_t *mBits;
+      const uint32_t *mDisabled;
+      const char *mData[64];   // next component data per type
+      uint32_t mDataSize[64];
+      uint64_t mTypes;
+      size_t mNext;            // next entity to commit
+      std::vector<Entity *> mCreated;
+
+   public:
+      Chunk(): mHeader(nullptr), mBits(nullptr), mDisabled(nullptr), mTypes(0), mNext(0) {}
+
+      /**
+       * Checks a chunk against its size and the component types registered in the world.
+       *
+       * @param data the ChunkHeader and what follows it, must stay valid until the chunk is committed.
+       * @return false if the chunk is malformed or holds a type registered differently.
+       */
+      bool parse(World *world, const char *data, size_t size);
+
+      /**
+       * Creates the next entities of the chunk, with ids taken as one block, fills
+       * their component storage and adds them to the world.
+       *
+       * @param max entities to commit at most.
+       * @param created if not null, receives the entities committed.
+       * @return number of entities committed.
+       */
+      size_t commit(World *world, size_t max, std::vector<Entity *> *created = nullptr);
+
+      bool isDone() const { return mHeader == nullptr || mNext >= mHeader->entityCount; }
+      size_t getRemaining() const { return mHeader != nullptr ? mHeader->entityCount - mNext : 0; }
+   };
+
+   /**
+    * Writes entities to a file. Their ids, systems and components of unregistered
+    * types are not saved.
+    *
+    * @param entitiesPerChunk entities per chunk, the unit of background reading.
+    * @return false if the file could not be written.
+    */
+   static bool write(World *world, Entity *const *entities, size_t count, const std::string &path, size_t entitiesPerChunk = 1024);
+
+   /**
+    * Checks the file header.
+    *
+    * @return false if the data is not an entity file of this version.
+    */
+   static bool readHeader(const char *data, size_t size, Header &header);
+
+   /**
+    * Reads a whole file into a world at once.
+    *
+    * @param created if not null, receives the entities created.
+    * @return false if the file cannot be read or is malformed; the chunks before the
+    *         malformed one are committed.
+    */
+   static bool read(World *world, const std::string &path, std::vector<Entity *> *created = nullptr);
+};
+
+}
+#endif // Artemis_EntityFile_h__
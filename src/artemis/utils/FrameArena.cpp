@@ -0,0 +1,78 @@
+#include "artemis/utils/FrameArena.h"
+#include <cstdint>
+#include <new>
+
+namespace artemis
+{
+
+FrameArena::FrameArena(size_t chunkSize): mChunks(nullptr), mCursor(nullptr), mEnd(nullptr),
+   mChunkSize(chunkSize), mUsed(0), mHighWater(0)
+{
+}
+
+FrameArena::~FrameArena()
+{
+   freeChunks();
+}
+
+void FrameArena::addChunk(size_t size)
+{
+   Chunk *chunk = static_cast<Chunk *>(::operator new(sizeof(Chunk) + size));
+   chunk->next = mChunks;
+   chunk->size = size;
+   mChunks = chunk;
+   mCursor = reinterpret_cast<char *>(chunk + 1);
+   mEnd = mCursor + size;
+}
+
+void FrameArena::freeChunks()
+{
+   while (mChunks != nullptr) {
+      Chunk *next = mChunks->next;
+      ::operator delete(mChunks);
+      mChunks = next;
+   }
+   mCursor = mEnd = nullptr;
+}
+
+void * FrameArena::allocate(size_t bytes, size_t alignment)
+{
+   uintptr_t p = (reinterpret_cast<uintptr_t>(mCursor) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+   if (mCursor == nullptr || p + bytes > reinterpret_cast<uintptr_t>(mEnd)) {
+      addChunk(bytes + alignment > mChunkSize ? bytes + alignment : mChunkSize);
+      p = (reinterpret_cast<uintptr_t>(mCursor) + alignment - 1) & ~(uintptr_t)(alignment - 1);
+   }
+
+   char *result = reinterpret_cast<char *>(p);
+   mUsed += (result + bytes) - mCursor;
+   mCursor = result + bytes;
+   if (mUsed > mHighWater) {
+      mHighWater = mUsed;
+   }
+   return result;
+}
+
+void FrameArena::reset()
+{
+   if (mChunks != nullptr && mChunks->next != nullptr) {
+      // merge into a single chunk, next frames of this size fit without allocating
+      size_t size = getCapacity();
+      freeChunks();
+      addChunk(size);
+   }
+   else if (mChunks != nullptr) {
+      mCursor = reinterpret_cast<char *>(mChunks + 1);
+   }
+   mUsed = 0;
+}
+
+size_t FrameArena::getCapacity() const
+{
+   size_t size = 0;
+   for (Chunk *chunk = mChunks; chunk != nullptr; chunk = chunk->next) {
+      size += chunk->size;
+   }
+   return size;
+}
+
+}
@@ -0,0 +1,85 @@
+#ifndef Artemis_FrameArena_h__
+#define Artemis_FrameArena_h__
+
+#include "artemis/utils/Allocator.h"
+#include <type_traits>
+
+namespace artemis
+{
+
+/**
+ * Linear allocator for data that only lives for a frame.
+ * Allocation bumps a pointer, deallocate() does nothing and reset() releases
+ * everything at once. When a frame needed more than one chunk, reset() merges
+ * them into a single chunk, so once the arena has seen its largest frame it
+ * no longer touches the heap.
+ */
+class FrameArena : public Allocator
+{
+private:
+   struct Chunk
+   {
+      Chunk *next;
+      size_t size;
+   };
+
+   Chunk *mChunks; // chunk being allocated from, followed by older ones
+   char *mCursor;
+   char *mEnd;
+   size_t mChunkSize;
+   size_t mUsed;
+   size_t mHighWater;
+
+   void addChunk(size_t size);
+   void freeChunks();
+
+   FrameArena(const FrameArena &) = delete;
+   FrameArena & operator=(const FrameArena &) = delete;
+
+public:
+   /**
+    * @param chunkSize size of the memory blocks taken from the heap.
+    */
+   FrameArena(size_t chunkSize = 64 * 1024);
+   ~FrameArena();
+
+   void * allocate(size_t bytes, size_t alignment) override;
+   void deallocate(void *p, size_t bytes, size_t alignment) override {}
+
+   /**
+    * Allocates uninitialized room for count objects of type T.
+    * Nothing allocated from the arena is destroyed, so T must not need a destructor.
+    *
+    * @param count number of objects.
+    * @return the first object.
+    */
+   template<typename T>
+   T * allocateArray(size_t count)
+   {
+      static_assert(std::is_trivially_destructible<T>::value, "FrameArena never runs destructors");
+      return static_cast<T *>(allocate(sizeof(T)*count, alignof(T)));
+   }
+
+   /**
+    * Releases everything allocated since the last reset.
+    */
+   void reset();
+
+   /**
+    * @return bytes handed out since the last reset.
+    */
+   size_t getUsed() const { return mUsed; }
+
+   /**
+    * @return most bytes handed out between two resets.
+    */
+   size_t getHighWater() const { return mHighWater; }
+
+   /**
+    * @return bytes held from the heap.
+    */
+   size_t getCapacity() const;
+};
+
+}
+#endif // Artemis_FrameArena_h__
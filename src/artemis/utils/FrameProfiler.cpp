@@ -0,0 +1,230 @@
+#include "artemis/utils/FrameProfiler.h"
+#include "artemis/utils/Instrumentation.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <vector>
+
+namespace artemis
+{
+
+FrameProfiler::FrameProfiler(size_t frames): mCapacity(frames > 0 ? frames : 1), mHead(0), mCursor(0), mStarted(false)
+{
+   mSlots = new Slot[mCapacity];
+   for (size_t i = 0; i < mCapacity; ++i) {
+      mSlots[i].seq.store(0, std::memory_order_relaxed);
+      std::memset(&mSlots[i].record, 0, sizeof(FrameRecord));
+   }
+   std::memset(&mCurrent, 0, sizeof(FrameRecord));
+   mEpoch = now();
+}
+
+FrameProfiler::~FrameProfiler()
+{
+   delete[] mSlots;
+}
+
+uint64_t FrameProfiler::now()
+{
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void FrameProfiler::beginFrame()
+{
+   mStarted = true;
+   mCursor = now();
+   mCurrent.frame = mHead.load(std::memory_order_relaxed);
+   mCurrent.start = mCursor - mEpoch;
+   mCurrent.systemsRun = 0;
+}
+
+void FrameProfiler::endPhase(int phase)
+{
+   uint64_t t = now();
+   mCurrent.phases[phase].start = static_cast<uint32_t>(mCursor - mEpoch - mCurrent.start);
+   mCurrent.phases[phase].duration = static_cast<uint32_t>(t - mCursor);
+   mCursor = t;
+}
+
+void FrameProfiler::recordSystem(EntitySystemType type, uint64_t start, uint64_t afterBegin, uint64_t afterProcess, uint64_t afterEnd)
+{
+   if (type >= MAX_SYSTEMS)
+      return;
+
+   SystemSpan &span = mCurrent.systems[type];
+   span.start = static_cast<uint32_t>(start - mEpoch - mCurrent.start);
+   span.begin = static_cast<uint32_t>(afterBegin - start);
+   span.process = static_cast<uint32_t>(afterProcess - afterBegin);
+   span.end = static_cast<uint32_t>(afterEnd - afterProcess);
+   mCurrent.systemsRun |= uint64_t(1) << type;
+}
+
+void FrameProfiler::endFrame()
+{
+   mCurrent.duration = static_cast<uint32_t>(now() - mEpoch - mCurrent.start);
+
+   uint64_t head = mHead.load(std::memory_order_relaxed);
+   Slot &slot = mSlots[head % mCapacity];
+   uint64_t seq = slot.seq.load(std::memory_order_relaxed);
+   slot.seq.store(seq + 1, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_release);
+   std::memcpy(&slot.record, &mCurrent, sizeof(FrameRecord));
+   slot.seq.store(seq + 2, std::memory_order_release);
+   mHead.store(head + 1, std::memory_order_release);
+}
+
+bool FrameProfiler::readFrame(uint64_t frame, FrameRecord &out) const
+{
+   const Slot &slot = mSlots[frame % mCapacity];
+   for (;;) {
+      uint64_t head = mHead.load(std::memory_order_acquire);
+      if (frame >= head || head - frame > mCapacity)
+         return false;
+
+      uint64_t before = slot.seq.load(std::memory_order_acquire);
+      if (before & 1)
+         continue;
+      std::memcpy(&out, &slot.record, sizeof(FrameRecord));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (slot.seq.load(std::memory_order_relaxed) == before)
+         return out.frame == frame;
+   }
+}
+
+bool FrameProfiler::setSystemName(EntitySystemType type, const std::string &name)
+{
+   if (mStarted || type >= MAX_SYSTEMS)
+      return false;
+   mSystemNames[type] = name;
+   return true;
+}
+
+std::string FrameProfiler::getSystemName(EntitySystemType type) const
+{
+   if (type < MAX_SYSTEMS && !mSystemNames[type].empty())
+      return mSystemNames[type];
+   return "system " + std::to_string(type);
+}
+
+FrameProfiler::Percentiles FrameProfiler::percentiles(uint64_t *values, size_t count)
+{
+   Percentiles result;
+   result.samples = count;
+   if (count == 0) {
+      result.p50 = result.p95 = result.p99 = result.max = 0;
+      return result;
+   }
+   std::sort(values, values + count);
+   result.p50 = values[(count - 1) * 50 / 100];
+   result.p95 = values[(count - 1) * 95 / 100];
+   result.p99 = values[(count - 1) * 99 / 100];
+   result.max = values[count - 1];
+   return result;
+}
+
+FrameProfiler::Percentiles FrameProfiler::getSystemPercentiles(EntitySystemType type) const
+{
+   std::vector<uint64_t> values;
+   values.reserve(mCapacity);
+   FrameRecord record;
+   uint64_t head = getFrameCount();
+   for (uint64_t f = head > mCapacity ? head - mCapacity : 0; f < head; ++f) {
+      if (type < MAX_SYSTEMS && readFrame(f, record) && (record.systemsRun & (uint64_t(1) << type))) {
+         const SystemSpan &span = record.systems[type];
+         values.push_back(uint64_t(span.begin) + span.process + span.end);
+      }
+   }
+   return percentiles(values.data(), values.size());
+}
+
+FrameProfiler::Percentiles FrameProfiler::getPhasePercentiles(int phase) const
+{
+   std::vector<uint64_t> values;
+   values.reserve(mCapacity);
+   FrameRecord record;
+   uint64_t head = getFrameCount();
+   for (uint64_t f = head > mCapacity ? head - mCapacity : 0; f < head; ++f) {
+      if (readFrame(f, record)) {
+         values.push_back(record.phases[phase].duration);
+      }
+   }
+   return percentiles(values.data(), values.size());
+}
+
+FrameProfiler::Percentiles FrameProfiler::getFramePercentiles() const
+{
+   std::vector<uint64_t> values;
+   values.reserve(mCapacity);
+   FrameRecord record;
+   uint64_t head = getFrameCount();
+   for (uint64_t f = head > mCapacity ? head - mCapacity : 0; f < head; ++f) {
+      if (readFrame(f, record)) {
+         values.push_back(record.duration);
+      }
+   }
+   return percentiles(values.data(), values.size());
+}
+
+const char * FrameProfiler::getPhaseName(int phase)
+{
+   static const char *names[ppPHASES_CNT] = {
+      "check added",
+      "check changed",
+      "check disabled",
+      "check enabled",
+      "check deleted",
+      "bulk operations",
+      "ComponentManager::clean",
+      "EntityManager::clean"
+   };
+   return phase >= 0 && phase < ppPHASES_CNT ? names[phase] : "unknown";
+}
+
+namespace
+{
+
+void writeEvent(std::ostream &out, bool &first, const std::string &name, int tid, uint64_t start, uint64_t duration)
+{
+   out << (first ? "\n" : ",\n");
+   first = false;
+   out << "{\"name\":\"";
+   Instrumentation::writeEscaped(out, name.c_str());
+   out << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << tid
+       << ",\"ts\":" << start / 1000 << '.' << (start % 1000) / 100 << (start % 100) / 10 << start % 10
+       << ",\"dur\":" << duration / 1000 << '.' << (duration % 1000) / 100 << (duration % 100) / 10 << duration % 10 << '}';
+}
+
+}
+
+void FrameProfiler::writeChromeTrace(std::ostream &out) const
+{
+   out << "{\"traceEvents\":[";
+   bool first = true;
+
+   FrameRecord record;
+   uint64_t head = getFrameCount();
+   for (uint64_t f = head > mCapacity ? head - mCapacity : 0; f < head; ++f) {
+      if (!readFrame(f, record))
+         continue;
+
+      writeEvent(out, first, "frame " + std::to_string(record.frame), 0, record.start, record.duration);
+      for (int p = 0; p < ppPHASES_CNT; ++p) {
+         writeEvent(out, first, getPhaseName(p), 0, record.start + record.phases[p].start, record.phases[p].duration);
+      }
+      for (EntitySystemType s = 0; s < MAX_SYSTEMS; ++s) {
+         if (!(record.systemsRun & (uint64_t(1) << s)))
+            continue;
+         const SystemSpan &span = record.systems[s];
+         uint64_t start = record.start + span.start;
+         std::string name = getSystemName(s);
+         writeEvent(out, first, name, 0, start, uint64_t(span.begin) + span.process + span.end);
+         writeEvent(out, first, name + " begin", 0, start, span.begin);
+         writeEvent(out, first, name + " processEntities", 0, start + span.begin, span.process);
+         writeEvent(out, first, name + " end", 0, start + span.begin + span.process, span.end);
+      }
+   }
+   out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+}
+
+}
@@ -0,0 +1,169 @@
+#ifndef Artemis_FrameProfiler_h__
+#define Artemis_FrameProfiler_h__
+
+#include "artemis/EntitySystemType.h"
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace artemis
+{
+
+/**
+ * Times every phase of World.process() and every system's begin/processEntities/end,
+ * keeping the last frames in a ring buffer. The simulation thread is the only writer;
+ * any thread may read frames, percentiles or a trace while the world keeps running,
+ * readers never block the writer. Enable it with World.enableProfiler().
+ */
+class FrameProfiler
+{
+public:
+   static const size_t MAX_SYSTEMS = 64;
+
+   enum ProfilerPhases {
+      ppCheckAdded = 0,
+      ppCheckChanged,
+      ppCheckDisabled,
+      ppCheckEnabled,
+      ppCheckDeleted,
+      ppBulkOperations,
+      ppComponentClean,
+      ppEntityClean,
+      ppPHASES_CNT
+   };
+
+   /**
+    * Times are in nanoseconds, starts are relative to the start of the frame.
+    */
+   struct Span
+   {
+      uint32_t start;
+      uint32_t duration;
+   };
+
+   struct SystemSpan
+   {
+      uint32_t start;
+      uint32_t begin;
+      uint32_t process;
+      uint32_t end;
+   };
+
+   struct FrameRecord
+   {
+      uint64_t frame;
+      uint64_t start; // nanoseconds since the profiler was created
+      uint32_t duration;
+      Span phases[ppPHASES_CNT];
+      uint64_t systemsRun; // bit per system type that was processed this frame
+      SystemSpan systems[MAX_SYSTEMS];
+   };
+
+   struct Percentiles
+   {
+      size_t samples;
+      uint64_t p50;
+      uint64_t p95;
+      uint64_t p99;
+      uint64_t max;
+   };
+
+private:
+   struct Slot
+   {
+      std::atomic<uint64_t> seq; // odd while the record is being written
+      FrameRecord record;
+   };
+
+   Slot *mSlots;
+   size_t mCapacity;
+   std::atomic<uint64_t> mHead;
+   uint64_t mEpoch;
+
+   FrameRecord mCurrent;
+   uint64_t mCursor;
+   bool mStarted;
+
+   // Fixed once frames are recorded, so readers of the records can use them unlocked.
+   std::string mSystemNames[MAX_SYSTEMS];
+
+   FrameProfiler(const FrameProfiler &) = delete;
+   FrameProfiler & operator=(const FrameProfiler &) = delete;
+
+   static Percentiles percentiles(uint64_t *values, size_t count);
+
+public:
+   /**
+    * @param frames number of frames kept.
+    */
+   FrameProfiler(size_t frames);
+   ~FrameProfiler();
+
+   /**
+    * @return monotonic time in nanoseconds.
+    */
+   static uint64_t now();
+
+   // Called by World and EntitySystem on the simulation thread.
+   void beginFrame();
+   void endPhase(int phase);
+   void recordSystem(EntitySystemType type, uint64_t start, uint64_t afterBegin, uint64_t afterProcess, uint64_t afterEnd);
+   void endFrame();
+
+   /**
+    * Names a system in reports and traces, instead of its type number. Names are
+    * set on the simulation thread before the first frame, since other threads may
+    * read them along with the frames.
+    *
+    * @return false if frames were recorded already, the name is then left unchanged.
+    */
+   bool setSystemName(EntitySystemType type, const std::string &name);
+   std::string getSystemName(EntitySystemType type) const;
+
+   /**
+    * @return number of frames recorded since the profiler was created.
+    */
+   uint64_t getFrameCount() const { return mHead.load(std::memory_order_acquire); }
+
+   /**
+    * @return number of frames the ring buffer holds.
+    */
+   size_t getCapacity() const { return mCapacity; }
+
+   /**
+    * Copies a recorded frame.
+    *
+    * @param frame number of the frame, from getFrameCount() - getCapacity() to getFrameCount() - 1.
+    * @param out the copy.
+    * @return false if the frame is not recorded yet or was overwritten.
+    */
+   bool readFrame(uint64_t frame, FrameRecord &out) const;
+
+   /**
+    * Percentiles of a system's begin + processEntities + end time over the frames
+    * in the buffer where it was processed, in nanoseconds.
+    */
+   Percentiles getSystemPercentiles(EntitySystemType type) const;
+
+   /**
+    * Percentiles of a World.process() phase, in nanoseconds.
+    */
+   Percentiles getPhasePercentiles(int phase) const;
+
+   /**
+    * Percentiles of whole frames, in nanoseconds.
+    */
+   Percentiles getFramePercentiles() const;
+
+   /**
+    * Writes the frames in the buffer as Chrome trace-event JSON,
+    * viewable in chrome://tracing or Perfetto.
+    */
+   void writeChromeTrace(std::ostream &out) const;
+
+   static const char * getPhaseName(int phase);
+};
+
+}
+#endif // Artemis_FrameProfiler_h__
@@ -0,0 +1,205 @@
+#include "artemis/utils/Instrumentation.h"
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define ARTEMIS_HAS_TSC 1
+#endif
+
+namespace artemis
+{
+
+namespace
+{
+
+/*
+ * Single-writer ring of events. The writer fills a slot, then publishes it by
+ * advancing head; readers copy a range and drop what head has overtaken since.
+ */
+struct ThreadBuffer
+{
+   Instrumentation::Event *events;
+   size_t capacity;
+   std::atomic<uint64_t> head;
+   unsigned int thread;
+   unsigned int depth;
+};
+
+std::mutex buffersMutex;
+std::vector<ThreadBuffer *> buffers; // never freed, events outlive their thread
+size_t bufferCapacity = 1 << 16;
+
+thread_local ThreadBuffer *threadBuffer = nullptr;
+
+std::once_flag calibrated;
+uint64_t tickBase = 0;
+double nanosecondsPerTick = 1.0;
+
+ThreadBuffer * getThreadBuffer()
+{
+   if (threadBuffer == nullptr) {
+      Instrumentation::calibrate();
+      ThreadBuffer *buffer = new ThreadBuffer();
+      std::lock_guard<std::mutex> lock(buffersMutex);
+      buffer->capacity = bufferCapacity;
+      buffer->events = new Instrumentation::Event[buffer->capacity];
+      buffer->head.store(0, std::memory_order_relaxed);
+      buffer->thread = static_cast<unsigned int>(buffers.size());
+      buffer->depth = 0;
+      buffers.push_back(buffer);
+      threadBuffer = buffer;
+   }
+   return threadBuffer;
+}
+
+uint64_t steadyNanoseconds()
+{
+   return std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void doCalibrate()
+{
+#ifdef ARTEMIS_HAS_TSC
+   uint64_t ns0 = steadyNanoseconds();
+   uint64_t tsc0 = __rdtsc();
+   uint64_t ns1;
+   do {
+      ns1 = steadyNanoseconds();
+   } while (ns1 - ns0 < 10000000);
+   uint64_t tsc1 = __rdtsc();
+   nanosecondsPerTick = tsc1 > tsc0 ? static_cast<double>(ns1 - ns0) / (tsc1 - tsc0) : 1.0;
+#endif
+   tickBase = Instrumentation::now();
+}
+
+}
+
+Instrumentation::Zone::Zone(const Site *site): mSite(site)
+{
+   enter();
+   mBegin = now();
+}
+
+Instrumentation::Zone::~Zone()
+{
+   record(mSite, mBegin, now());
+}
+
+void Instrumentation::setBufferCapacity(size_t events)
+{
+   std::lock_guard<std::mutex> lock(buffersMutex);
+   bufferCapacity = events > 0 ? events : 1;
+}
+
+uint64_t Instrumentation::now()
+{
+#ifdef ARTEMIS_HAS_TSC
+   return __rdtsc();
+#else
+   return steadyNanoseconds();
+#endif
+}
+
+double Instrumentation::toNanoseconds(uint64_t ticks)
+{
+   return ticks > tickBase ? (ticks - tickBase) * nanosecondsPerTick : 0.0;
+}
+
+void Instrumentation::calibrate()
+{
+   std::call_once(calibrated, doCalibrate);
+}
+
+unsigned int Instrumentation::enter()
+{
+   return getThreadBuffer()->depth++;
+}
+
+void Instrumentation::record(const Site *site, uint64_t begin, uint64_t end)
+{
+   ThreadBuffer *buffer = threadBuffer;
+   uint64_t head = buffer->head.load(std::memory_order_relaxed);
+   Event &event = buffer->events[head % buffer->capacity];
+   event.site = site;
+   event.begin = begin;
+   event.end = end;
+   event.depth = --buffer->depth;
+   event.thread = buffer->thread;
+   buffer->head.store(head + 1, std::memory_order_release);
+}
+
+void Instrumentation::collect(std::vector<Event> &out)
+{
+   std::vector<ThreadBuffer *> snapshot;
+   {
+      std::lock_guard<std::mutex> lock(buffersMutex);
+      snapshot = buffers;
+   }
+
+   for (size_t b = 0; b < snapshot.size(); ++b) {
+      ThreadBuffer *buffer = snapshot[b];
+      uint64_t head = buffer->head.load(std::memory_order_acquire);
+      uint64_t first = head > buffer->capacity ? head - buffer->capacity : 0;
+      size_t start = out.size();
+      for (uint64_t i = first; i < head; ++i) {
+         out.push_back(buffer->events[i % buffer->capacity]);
+      }
+      std::atomic_thread_fence(std::memory_order_acquire);
+
+      // drop the events the writer may have overwritten while they were copied
+      uint64_t after = buffer->head.load(std::memory_order_relaxed);
+      uint64_t valid = after > buffer->capacity ? after - buffer->capacity : 0;
+      if (valid > first) {
+         size_t overwritten = static_cast<size_t>(std::min(valid - first, head - first));
+         out.erase(out.begin() + start, out.begin() + start + overwritten);
+      }
+   }
+}
+
+void Instrumentation::writeEscaped(std::ostream &out, const char *s)
+{
+   static const char hex[] = "0123456789abcdef";
+   for (; *s; ++s) {
+      unsigned char c = static_cast<unsigned char>(*s);
+      if (c < 0x20) {
+         out << "\\u00" << hex[c >> 4] << hex[c & 15];
+         continue;
+      }
+      if (c == '"' || c == '\\')
+         out << '\\';
+      out << *s;
+   }
+}
+
+void Instrumentation::writeChromeTrace(std::ostream &out)
+{
+   std::vector<Event> events;
+   collect(events);
+
+   std::ios::fmtflags flags = out.flags();
+   std::streamsize precision = out.precision();
+   out << "{\"traceEvents\":[";
+   out.setf(std::ios::fixed, std::ios::floatfield);
+   out.precision(3);
+   for (size_t i = 0; i < events.size(); ++i) {
+      const Event &e = events[i];
+      double begin = toNanoseconds(e.begin) / 1000.0;
+      double duration = e.end > e.begin ? (e.end - e.begin) * nanosecondsPerTick / 1000.0 : 0.0;
+      out << (i == 0 ? "\n" : ",\n")
+          << "{\"name\":\"";
+      writeEscaped(out, e.site->name);
+      out << "\",\"ph\":\"X\",\"pid\":0,\"tid\":" << e.thread
+          << ",\"ts\":" << begin << ",\"dur\":" << duration
+          << ",\"args\":{\"file\":\"";
+      writeEscaped(out, e.site->file);
+      out << "\",\"line\":" << e.site->line << "}}";
+   }
+   out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+   out.flags(flags);
+   out.precision(precision);
+}
+
+}
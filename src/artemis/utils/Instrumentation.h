@@ -0,0 +1,110 @@
+#ifndef Artemis_Instrumentation_h__
+#define Artemis_Instrumentation_h__
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace artemis
+{
+
+/**
+ * Instrumentation zones: ARTEMIS_ZONE("name") times the enclosing scope. Zones are
+ * compiled in only when ARTEMIS_INSTRUMENT is defined, otherwise the macro expands
+ * to nothing. World.process(), EntitySystem.process(), ComponentManager and
+ * EntityManager have zones; user code can declare its own the same way.
+ *
+ * Each thread records the zones it ran into its own ring buffer, with timestamps
+ * from the TSC where available, calibrated against the steady clock. Recording
+ * never locks; collect() and writeChromeTrace() may run on any thread while the
+ * buffers are being written, and skip the events overwritten meanwhile.
+ */
+class Instrumentation
+{
+public:
+   /**
+    * A zone in the source, declared once per ARTEMIS_ZONE.
+    */
+   struct Site
+   {
+      const char *name;
+      const char *file;
+      int line;
+   };
+
+   struct Event
+   {
+      const Site *site;
+      uint64_t begin; // ticks
+      uint64_t end;
+      unsigned int depth;
+      unsigned int thread;
+   };
+
+   class Zone
+   {
+   private:
+      const Site *mSite;
+      uint64_t mBegin;
+   public:
+      Zone(const Site *site);
+      ~Zone();
+   };
+
+   /**
+    * Events each thread keeps, set before the first zone runs.
+    */
+   static void setBufferCapacity(size_t events);
+
+   /**
+    * @return current time in ticks.
+    */
+   static uint64_t now();
+
+   /**
+    * Converts ticks to nanoseconds since the clock was calibrated.
+    */
+   static double toNanoseconds(uint64_t ticks);
+
+   /**
+    * Measures the tick rate against the steady clock for about 10 milliseconds.
+    * Done on first use, call it up front to keep it out of the first frame.
+    */
+   static void calibrate();
+
+   /**
+    * Copies the events still held by every thread's buffer, oldest first per thread.
+    */
+   static void collect(std::vector<Event> &out);
+
+   /**
+    * Writes the collected events as Chrome trace-event JSON.
+    */
+   static void writeChromeTrace(std::ostream &out);
+
+   /**
+    * Writes a string as the contents of a JSON string, escaping quotes,
+    * backslashes and control characters.
+    */
+   static void writeEscaped(std::ostream &out, const char *s);
+
+   // Called by Zone.
+   static void record(const Site *site, uint64_t begin, uint64_t end);
+   static unsigned int enter();
+};
+
+}
+
+#ifdef ARTEMIS_INSTRUMENT
+#define ARTEMIS_ZONE_CONCAT2(a, b) a##b
+#define ARTEMIS_ZONE_CONCAT(a, b) ARTEMIS_ZONE_CONCAT2(a, b)
+#define ARTEMIS_ZONE(name) \
+   static const artemis::Instrumentation::Site ARTEMIS_ZONE_CONCAT(artemisZoneSite__, __LINE__) = { name, __FILE__, __LINE__ }; \
+   artemis::Instrumentation::Zone ARTEMIS_ZONE_CONCAT(artemisZone__, __LINE__)(&ARTEMIS_ZONE_CONCAT(artemisZoneSite__, __LINE__))
+#else
+#define ARTEMIS_ZONE(name)
+#endif // ARTEMIS_INSTRUMENT
+
+#endif // Artemis_Instrumentation_h__
@@ -0,0 +1,189 @@
+#include "artemis/utils/MappedFile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace artemis
+{
+
+#if defined(_WIN32)
+
+MappedFile::MappedFile(): mData(nullptr), mSize(0), mWritable(false), mFile(INVALID_HANDLE_VALUE), mMapping(nullptr)
+{
+}
+
+bool MappedFile::openRead(const std::string &path)
+{
+   close();
+   mFile = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+   LARGE_INTEGER size;
+   if (mFile == INVALID_HANDLE_VALUE || !GetFileSizeEx(mFile, &size)) {
+      close();
+      return false;
+   }
+   mWritable = false;
+   mSize = static_cast<size_t>(size.QuadPart);
+   if (!map()) {
+      close();
+      return false;
+   }
+   return true;
+}
+
+bool MappedFile::openWrite(const std::string &path, size_t size)
+{
+   close();
+   mFile = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+   if (mFile == INVALID_HANDLE_VALUE)
+      return false;
+   mWritable = true;
+   if (!resize(size)) {
+      close();
+      return false;
+   }
+   return true;
+}
+
+bool MappedFile::resize(size_t size)
+{
+   if (!mWritable || mFile == INVALID_HANDLE_VALUE)
+      return false;
+   unmap();
+   LARGE_INTEGER end;
+   end.QuadPart = static_cast<LONGLONG>(size);
+   if (!SetFilePointerEx(mFile, end, nullptr, FILE_BEGIN) || !SetEndOfFile(mFile))
+      return false;
+   mSize = size;
+   return map();
+}
+
+bool MappedFile::map()
+{
+   if (mSize == 0)
+      return true;
+   mMapping = CreateFileMappingA(mFile, nullptr, mWritable ? PAGE_READWRITE : PAGE_READONLY, 0, 0, nullptr);
+   if (mMapping == nullptr)
+      return false;
+   mData = static_cast<char *>(MapViewOfFile(mMapping, mWritable ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, mSize));
+   return mData != nullptr;
+}
+
+void MappedFile::unmap()
+{
+   if (mData != nullptr)
+      UnmapViewOfFile(mData);
+   if (mMapping != nullptr)
+      CloseHandle(mMapping);
+   mData = nullptr;
+   mMapping = nullptr;
+}
+
+bool MappedFile::sync()
+{
+   return mData == nullptr || FlushViewOfFile(mData, mSize) != 0;
+}
+
+void MappedFile::close()
+{
+   unmap();
+   if (mFile != INVALID_HANDLE_VALUE)
+      CloseHandle(mFile);
+   mFile = INVALID_HANDLE_VALUE;
+   mSize = 0;
+}
+
+#else
+
+MappedFile::MappedFile(): mData(nullptr), mSize(0), mWritable(false), mFd(-1)
+{
+}
+
+bool MappedFile::openRead(const std::string &path)
+{
+   close();
+   mFd = ::open(path.c_str(), O_RDONLY);
+   struct stat st;
+   if (mFd < 0 || fstat(mFd, &st) != 0) {
+      close();
+      return false;
+   }
+   mWritable = false;
+   mSize = static_cast<size_t>(st.st_size);
+   if (!map()) {
+      close();
+      return false;
+   }
+   return true;
+}
+
+bool MappedFile::openWrite(const std::string &path, size_t size)
+{
+   close();
+   mFd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+   if (mFd < 0)
+      return false;
+   mWritable = true;
+   if (!resize(size)) {
+      close();
+      return false;
+   }
+   return true;
+}
+
+bool MappedFile::resize(size_t size)
+{
+   if (!mWritable || mFd < 0)
+      return false;
+   unmap();
+   if (ftruncate(mFd, static_cast<off_t>(size)) != 0)
+      return false;
+   mSize = size;
+   return map();
+}
+
+bool MappedFile::map()
+{
+   if (mSize == 0)
+      return true;
+   void *p = mmap(nullptr, mSize, mWritable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, mFd, 0);
+   if (p == MAP_FAILED)
+      return false;
+   mData = static_cast<char *>(p);
+   return true;
+}
+
+void MappedFile::unmap()
+{
+   if (mData != nullptr)
+      munmap(mData, mSize);
+   mData = nullptr;
+}
+
+bool MappedFile::sync()
+{
+   return mData == nullptr || msync(mData, mSize, MS_SYNC) == 0;
+}
+
+void MappedFile::close()
+{
+   unmap();
+   if (mFd >= 0)
+      ::close(mFd);
+   mFd = -1;
+   mSize = 0;
+}
+
+#endif // _WIN32
+
+MappedFile::~MappedFile()
+{
+   close();
+}
+
+}
@@ -0,0 +1,66 @@
+#ifndef Artemis_MappedFile_h__
+#define Artemis_MappedFile_h__
+
+#include <cstddef>
+#include <string>
+
+namespace artemis
+{
+
+/**
+ * A file mapped into memory, read-only or read-write.
+ */
+class MappedFile
+{
+private:
+   char *mData;
+   size_t mSize;
+   bool mWritable;
+#if defined(_WIN32)
+   void *mFile;
+   void *mMapping;
+#else
+   int mFd;
+#endif
+
+   MappedFile(const MappedFile &) = delete;
+   MappedFile & operator=(const MappedFile &) = delete;
+
+   bool map();
+   void unmap();
+
+public:
+   MappedFile();
+   ~MappedFile();
+
+   /**
+    * Maps an existing file for reading.
+    */
+   bool openRead(const std::string &path);
+
+   /**
+    * Creates or truncates a file of the given size and maps it for writing.
+    */
+   bool openWrite(const std::string &path, size_t size);
+
+   /**
+    * Changes the size of a file opened for writing and maps it again,
+    * data() may move.
+    */
+   bool resize(size_t size);
+
+   /**
+    * Flushes written pages to the file.
+    */
+   bool sync();
+
+   void close();
+
+   bool isOpen() const { return mData != nullptr; }
+   const char * data() const { return mData; }
+   char * data() { return mData; }
+   size_t size() const { return mSize; }
+};
+
+}
+#endif // Artemis_MappedFile_h__
@@ -0,0 +1,55 @@
+#include "artemis/utils/MemoryReport.h"
+
+namespace artemis
+{
+
+namespace
+{
+
+void printUsage(std::ostream &out, const char *name, size_t index, const MemoryUsage &usage)
+{
+   if (usage.reserved == 0)
+      return;
+   out << "  " << name;
+   if (index < MemoryReport::MAX_TYPES)
+      out << ' ' << index;
+   out << ": " << usage.used << " used, " << usage.reserved << " reserved\n";
+}
+
+}
+
+MemoryUsage MemoryReport::getTotal() const
+{
+   MemoryUsage total;
+   for (size_t i = 0; i < MAX_TYPES; ++i) {
+      total.add(componentStorage[i]);
+      total.add(componentObjects[i]);
+      total.add(systems[i]);
+      total.add(managers[i]);
+   }
+   total.add(entities);
+   total.add(identifierPool);
+   total.add(world);
+   return total;
+}
+
+void MemoryReport::print(std::ostream &out) const
+{
+   MemoryUsage total = getTotal();
+   out << "total: " << total.used << " bytes used, " << total.reserved << " reserved\n";
+   for (size_t i = 0; i < MAX_TYPES; ++i) {
+      printUsage(out, "component storage", i, componentStorage[i]);
+      printUsage(out, "component objects", i, componentObjects[i]);
+   }
+   for (size_t i = 0; i < MAX_TYPES; ++i) {
+      printUsage(out, "system", i, systems[i]);
+   }
+   for (size_t i = 0; i < MAX_TYPES; ++i) {
+      printUsage(out, "manager", i, managers[i]);
+   }
+   printUsage(out, "entities", MAX_TYPES, entities);
+   printUsage(out, "identifier pool", MAX_TYPES, identifierPool);
+   printUsage(out, "world", MAX_TYPES, world);
+}
+
+}
@@ -0,0 +1,66 @@
+#ifndef Artemis_MemoryReport_h__
+#define Artemis_MemoryReport_h__
+
+#include <cstddef>
+#include <map>
+#include <ostream>
+
+namespace artemis
+{
+
+/**
+ * Bytes in use and bytes reserved by some part of a world. Reserved includes what
+ * is in use plus spare capacity.
+ */
+struct MemoryUsage
+{
+   size_t used;
+   size_t reserved;
+
+   MemoryUsage(): used(0), reserved(0) {}
+
+   void add(size_t usedBytes, size_t reservedBytes)
+   {
+      used += usedBytes;
+      reserved += reservedBytes;
+   }
+
+   void add(const MemoryUsage &other) { add(other.used, other.reserved); }
+
+   /**
+    * Adds the nodes of a std::map, estimated as the value plus the tree links of
+    * a red-black tree node.
+    */
+   template<typename K, typename V>
+   void addMap(const std::map<K, V> &m)
+   {
+      size_t bytes = m.size() * (sizeof(typename std::map<K, V>::value_type) + 4 * sizeof(void *));
+      add(bytes, bytes);
+   }
+};
+
+/**
+ * Memory held by a world, see World.memoryReport().
+ */
+struct MemoryReport
+{
+   static const size_t MAX_TYPES = 64;
+
+   MemoryUsage componentStorage[MAX_TYPES]; // component pointers indexed by entity id
+   MemoryUsage componentObjects[MAX_TYPES];
+   MemoryUsage systems[MAX_TYPES];
+   MemoryUsage managers[MAX_TYPES];
+   MemoryUsage entities; // Entity objects and the entity table
+   MemoryUsage identifierPool;
+   MemoryUsage world; // frame arenas, manager and system tables
+
+   MemoryUsage getTotal() const;
+
+   /**
+    * Writes the non-empty entries.
+    */
+   void print(std::ostream &out) const;
+};
+
+}
+#endif // Artemis_MemoryReport_h__
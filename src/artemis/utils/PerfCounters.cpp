@@ -0,0 +1,174 @@
+#include "artemis/utils/PerfCounters.h"
+#include <cstring>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace artemis
+{
+
+#if defined(__linux__)
+
+namespace
+{
+
+int openCounter(uint64_t config, int group)
+{
+   perf_event_attr attr;
+   std::memset(&attr, 0, sizeof(attr));
+   attr.size = sizeof(attr);
+   attr.type = PERF_TYPE_HARDWARE;
+   attr.config = config;
+   attr.read_format = PERF_FORMAT_GROUP;
+   attr.disabled = group < 0 ? 1 : 0;
+   attr.exclude_kernel = 1;
+   attr.exclude_hv = 1;
+   return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, group, 0));
+}
+
+}
+
+PerfCounters::PerfCounters(): mLeader(-1), mOpened(0)
+{
+   static const uint64_t configs[pcCOUNTERS_CNT] = {
+      PERF_COUNT_HW_CPU_CYCLES,
+      PERF_COUNT_HW_INSTRUCTIONS,
+      PERF_COUNT_HW_CACHE_MISSES,
+      PERF_COUNT_HW_BRANCH_MISSES
+   };
+
+   for (int i = 0; i < pcCOUNTERS_CNT; ++i) {
+      mFds[i] = -1;
+      mIndex[i] = -1;
+   }
+
+   mLeader = openCounter(configs[pcCycles], -1);
+   if (mLeader >= 0) {
+      mFds[pcCycles] = mLeader;
+      mIndex[pcCycles] = mOpened++;
+      for (int i = pcCycles + 1; i < pcCOUNTERS_CNT; ++i) {
+         mFds[i] = openCounter(configs[i], mLeader);
+         if (mFds[i] >= 0) {
+            mIndex[i] = mOpened++;
+         }
+      }
+      ioctl(mLeader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+      ioctl(mLeader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+   }
+   reset();
+}
+
+PerfCounters::~PerfCounters()
+{
+   for (int i = pcCOUNTERS_CNT - 1; i >= 0; --i) {
+      if (mFds[i] >= 0)
+         close(mFds[i]);
+   }
+}
+
+bool PerfCounters::read(Sample &out) const
+{
+   // PERF_FORMAT_GROUP: the number of counters, then their values in the order they were opened
+   uint64_t buffer[1 + pcCOUNTERS_CNT];
+   if (mLeader < 0 || ::read(mLeader, buffer, sizeof(buffer)) < static_cast<ssize_t>(sizeof(uint64_t) * (1 + mOpened)))
+      return false;
+
+   for (int i = 0; i < pcCOUNTERS_CNT; ++i) {
+      out.values[i] = mIndex[i] >= 0 ? buffer[1 + mIndex[i]] : 0;
+   }
+   return true;
+}
+
+#else
+
+PerfCounters::PerfCounters(): mLeader(-1), mOpened(0)
+{
+   for (int i = 0; i < pcCOUNTERS_CNT; ++i) {
+      mFds[i] = -1;
+      mIndex[i] = -1;
+   }
+   reset();
+}
+
+PerfCounters::~PerfCounters()
+{
+}
+
+bool PerfCounters::read(Sample &) const
+{
+   return false;
+}
+
+#endif // __linux__
+
+void PerfCounters::beginFrame()
+{
+   std::memset(mFrame, 0, sizeof(mFrame));
+}
+
+void PerfCounters::record(EntitySystemType type, const Sample &before, const Sample &after)
+{
+   if (type >= MAX_SYSTEMS)
+      return;
+
+   for (int i = 0; i < pcCOUNTERS_CNT; ++i) {
+      uint64_t delta = after.values[i] - before.values[i];
+      mFrame[type].values[i] = delta;
+      mTotal[type].values[i] += delta;
+   }
+   mFrames[type]++;
+}
+
+void PerfCounters::reset()
+{
+   std::memset(mFrame, 0, sizeof(mFrame));
+   std::memset(mTotal, 0, sizeof(mTotal));
+   std::memset(mFrames, 0, sizeof(mFrames));
+   std::memset(&mNone, 0, sizeof(mNone));
+}
+
+void PerfCounters::print(std::ostream &out) const
+{
+   if (!isAvailable()) {
+      out << "performance counters unavailable\n";
+      return;
+   }
+
+   out << "system";
+   for (int i = 0; i < pcCOUNTERS_CNT; ++i) {
+      out << '\t' << getCounterName(i);
+   }
+   out << "\tIPC\tcache MPKI\tbranch MPKI\n";
+
+   for (EntitySystemType s = 0; s < MAX_SYSTEMS; ++s) {
+      if (mFrames[s] == 0)
+         continue;
+
+      const uint64_t *total = mTotal[s].values;
+      out << s;
+      for (int i = 0; i < pcCOUNTERS_CNT; ++i) {
+         out << '\t' << total[i] / mFrames[s];
+      }
+      double instructions = static_cast<double>(total[pcInstructions]);
+      out << '\t' << (total[pcCycles] ? instructions / total[pcCycles] : 0.0)
+          << '\t' << (total[pcInstructions] ? 1000.0 * total[pcCacheMisses] / instructions : 0.0)
+          << '\t' << (total[pcInstructions] ? 1000.0 * total[pcBranchMisses] / instructions : 0.0) << '\n';
+   }
+}
+
+const char * PerfCounters::getCounterName(int counter)
+{
+   static const char *names[pcCOUNTERS_CNT] = {
+      "cycles",
+      "instructions",
+      "cache misses",
+      "branch misses"
+   };
+   return counter >= 0 && counter < pcCOUNTERS_CNT ? names[counter] : "unknown";
+}
+
+}
@@ -0,0 +1,110 @@
+#ifndef Artemis_PerfCounters_h__
+#define Artemis_PerfCounters_h__
+
+#include "artemis/EntitySystemType.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+namespace artemis
+{
+
+/**
+ * Hardware performance counters sampled around every EntitySystem.process() call of
+ * World.process(), through Linux perf_event_open. Counts are kept for the last frame
+ * and summed over all frames since the last reset().
+ *
+ * The counters follow the thread that created them, enable them with
+ * World.enablePerfCounters() on the thread that runs World.process(). Counters the
+ * kernel or hardware does not provide read as 0; on other systems, or when
+ * perf_event_paranoid forbids it, isAvailable() is false and nothing is counted.
+ */
+class PerfCounters
+{
+public:
+   static const size_t MAX_SYSTEMS = 64;
+
+   enum PerfCounterTypes {
+      pcCycles = 0,
+      pcInstructions,
+      pcCacheMisses,
+      pcBranchMisses,
+      pcCOUNTERS_CNT
+   };
+
+   struct Sample
+   {
+      uint64_t values[pcCOUNTERS_CNT];
+   };
+
+private:
+   int mLeader;
+   int mFds[pcCOUNTERS_CNT];
+   int mIndex[pcCOUNTERS_CNT]; // position in the group read, -1 if not opened
+   int mOpened;
+
+   Sample mFrame[MAX_SYSTEMS];
+   Sample mTotal[MAX_SYSTEMS];
+   uint64_t mFrames[MAX_SYSTEMS];
+   Sample mNone; // all zero, for system types out of range
+
+   PerfCounters(const PerfCounters &) = delete;
+   PerfCounters & operator=(const PerfCounters &) = delete;
+
+public:
+   PerfCounters();
+   ~PerfCounters();
+
+   /**
+    * @return true if at least the cycle counter could be opened.
+    */
+   bool isAvailable() const { return mLeader >= 0; }
+
+   /**
+    * @return true if the counter could be opened.
+    */
+   bool hasCounter(int counter) const { return counter >= 0 && counter < pcCOUNTERS_CNT && mIndex[counter] >= 0; }
+
+   /**
+    * Reads the current values of all counters.
+    * @return false if they could not be read, out is then undefined.
+    */
+   bool read(Sample &out) const;
+
+   // Called by World on the thread running World.process().
+   void beginFrame();
+   void record(EntitySystemType type, const Sample &before, const Sample &after);
+
+   /**
+    * @return counts of the system in the last frame, zero for types past MAX_SYSTEMS.
+    */
+   const Sample & getFrame(EntitySystemType type) const { return type < MAX_SYSTEMS ? mFrame[type] : mNone; }
+
+   /**
+    * @return counts of the system summed over all frames since the last reset(),
+    *         zero for types past MAX_SYSTEMS.
+    */
+   const Sample & getTotal(EntitySystemType type) const { return type < MAX_SYSTEMS ? mTotal[type] : mNone; }
+
+   /**
+    * @return frames the system was sampled in since the last reset(), 0 for types
+    *         past MAX_SYSTEMS.
+    */
+   uint64_t getFrameCount(EntitySystemType type) const { return type < MAX_SYSTEMS ? mFrames[type] : 0; }
+
+   /**
+    * Clears the totals.
+    */
+   void reset();
+
+   /**
+    * Writes the per-frame averages of every sampled system, with instructions
+    * per cycle and misses per thousand instructions.
+    */
+   void print(std::ostream &out) const;
+
+   static const char * getCounterName(int counter);
+};
+
+}
+#endif // Artemis_PerfCounters_h__
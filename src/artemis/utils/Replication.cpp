@@ -0,0 +1,485 @@
+#include "artemis/utils/Replication.h"
+#include "artemis/utils/BitStream.h"
+#include "artemis/ComponentManager.h"
+#include "artemis/Entity.h"
+#include "artemis/World.h"
+#include "artemis/utils/Instrumentation.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace artemis
+{
+
+void ReplicationSchema::setType(ComponentType type, const ComponentCodec &codec)
+{
+   if (type >= 64)
+      return;
+   Type &t = mTypes[type];
+   t.codec = codec;
+   t.described = false;
+   t.fields.clear();
+   for (size_t offset = 0; offset < codec.size && t.fields.size() < MAX_FIELDS; offset += 4) {
+      Field field;
+      field.offset = codec.offset + offset;
+      field.size = codec.size - offset < 4 ? codec.size - offset : 4;
+      field.kind = fkWord;
+      field.precision = 0.f;
+      t.fields.push_back(field);
+   }
+   mRegistered.set(type);
+}
+
+void ReplicationSchema::addField(ComponentType type, size_t offset, size_t size, int kind, float precision)
+{
+   if (type >= 64 || !mRegistered.test(type))
+      return;
+   Type &t = mTypes[type];
+   if (!t.described) {
+      t.fields.clear();
+      t.described = true;
+   }
+   if (t.fields.size() >= MAX_FIELDS)
+      return;
+   Field field;
+   field.offset = offset;
+   field.size = size;
+   field.kind = kind;
+   field.precision = precision > 0.f ? precision : 1.f;
+   t.fields.push_back(field);
+}
+
+int64_t ReplicationSchema::read(const Component *component, const Field &field)
+{
+   const char *p = reinterpret_cast<const char *>(component) + field.offset;
+   switch (field.kind) {
+   case fkFloat: {
+      float value;
+      std::memcpy(&value, p, sizeof(float));
+      return std::llround(value / field.precision);
+   }
+   case fkInt: {
+      int32_t value;
+      std::memcpy(&value, p, sizeof(int32_t));
+      return value;
+   }
+   default: {
+      uint32_t value = 0;
+      std::memcpy(&value, p, field.size);
+      return value;
+   }
+   }
+}
+
+void ReplicationSchema::write(Component *component, const Field &field, int64_t value)
+{
+   char *p = reinterpret_cast<char *>(component) + field.offset;
+   switch (field.kind) {
+   case fkFloat: {
+      float v = static_cast<float>(value * static_cast<double>(field.precision));
+      std::memcpy(p, &v, sizeof(float));
+      break;
+   }
+   case fkInt: {
+      int32_t v = static_cast<int32_t>(value);
+      std::memcpy(p, &v, sizeof(int32_t));
+      break;
+   }
+   default: {
+      uint32_t v = static_cast<uint32_t>(value);
+      std::memcpy(p, &v, field.size);
+      break;
+   }
+   }
+}
+
+/*
+ * Frame layout, bit-packed:
+ *   varint frame count, bit keyframe,
+ *   varint number of deleted entities, per entity a varint id gap,
+ *   varint number of type sections,
+ *   per section: varint type, varint number of entries, per entry:
+ *      varint id gap, 2 bits op,
+ *      add: every field as a signed varint,
+ *      update: a bit per field, changed fields as signed varint deltas.
+ * Deletions come first so that an id reused since is added to a new entity.
+ * Ids are ascending, a gap is the id minus the previous id minus one.
+ */
+
+ReplicationEncoder::ReplicationEncoder(World *world, const ReplicationSchema &schema): mWorld(world), mSchema(schema), mFrameCount(0)
+{
+   mChanges.attach(world->getComponentManager(), schema.getTypes());
+}
+
+int ReplicationEncoder::addInterestSet(const std::bitset<64> &types)
+{
+   InterestSet set;
+   set.types = types & mSchema.getTypes();
+   // Recipients may get the entities that exist already from a keyframe, and
+   // decoders ignore kills of entities they do not have.
+   for (ComponentType t = 0; t < 64; ++t) {
+      if (!set.types.test(t))
+         continue;
+      const std::vector<bool> &present = mTypes[t].present;
+      if (present.size() > set.known.size())
+         set.known.resize(present.size(), false);
+      for (size_t id = 0; id < present.size(); ++id) {
+         if (present[id])
+            set.known[id] = true;
+      }
+   }
+   mSets.push_back(set);
+   return static_cast<int>(mSets.size() - 1);
+}
+
+void ReplicationEncoder::scan(ComponentType type)
+{
+   const ReplicationSchema::Type *schema = mSchema.getType(type);
+   const size_t fields = schema->fields.size();
+   TypeState &state = mTypes[type];
+   state.events.clear();
+
+   const std::vector<int> &changed = mChanges.getChanged(type);
+   if (changed.empty())
+      return;
+   Bag<Component *> *components = mWorld->getComponentManager()->getComponentsByType(type);
+   size_t n = static_cast<size_t>(changed.back()) + 1;
+   if (n > state.present.size()) {
+      state.present.resize(n, false);
+      state.sent.resize(n * fields);
+   }
+
+   for (size_t k = 0; k < changed.size(); ++k) {
+      size_t id = static_cast<size_t>(changed[k]);
+      Component *component = components->isIndexWithinBounds(id) ? components->get(id) : nullptr;
+      bool was = state.present[id];
+      if (component == nullptr && !was)
+         continue;
+
+      bool active = mWorld->getEntity(id) != nullptr;
+      int64_t *sent = &state.sent[id * fields];
+      Event event;
+      event.id = static_cast<int>(id);
+      event.mask = 0;
+      event.deltas = 0;
+
+      if (component == nullptr || !active) {
+         if (!was)
+            continue;
+         state.present[id] = false;
+         if (!active)
+            continue; // the deletion is sent instead
+         event.op = opRemove;
+      }
+      else if (!was) {
+         event.op = opAdd;
+         for (size_t f = 0; f < fields; ++f) {
+            sent[f] = ReplicationSchema::read(component, schema->fields[f]);
+         }
+         state.present[id] = true;
+      }
+      else {
+         event.op = opUpdate;
+         event.deltas = mDeltas.size();
+         for (size_t f = 0; f < fields; ++f) {
+            int64_t value = ReplicationSchema::read(component, schema->fields[f]);
+            if (value != sent[f]) {
+               event.mask |= uint64_t(1) << f;
+               mDeltas.push_back(value - sent[f]);
+               sent[f] = value;
+            }
+         }
+         if (event.mask == 0)
+            continue;
+      }
+      state.events.push_back(event);
+   }
+}
+
+void ReplicationEncoder::encode()
+{
+   ARTEMIS_ZONE("ReplicationEncoder::encode");
+   mDeltas.clear();
+   mChanges.sort();
+   const std::bitset<64> &types = mChanges.getTypes();
+
+   // What deleted entities had was sent, a reused id starts without components.
+   mDeleted.assign(mChanges.getDeleted().begin(), mChanges.getDeleted().end());
+   std::sort(mDeleted.begin(), mDeleted.end());
+   mDeleted.erase(std::unique(mDeleted.begin(), mDeleted.end()), mDeleted.end());
+   for (size_t i = 0; i < mDeleted.size(); ++i) {
+      size_t id = static_cast<size_t>(mDeleted[i]);
+      for (ComponentType t = 0; t < 64; ++t) {
+         if (types.test(t) && id < mTypes[t].present.size())
+            mTypes[t].present[id] = false;
+      }
+   }
+
+   for (ComponentType t = 0; t < 64; ++t) {
+      if (types.test(t))
+         scan(t);
+   }
+   mChanges.clear();
+   mFrameCount++;
+
+   for (size_t i = 0; i < mSets.size(); ++i) {
+      writeFrame(mSets[i]);
+   }
+}
+
+void ReplicationEncoder::writeFrame(InterestSet &set)
+{
+   std::shared_ptr<Buffer> buffer = std::make_shared<Buffer>();
+   BitWriter writer(buffer.get());
+   writer.writeVarint(mFrameCount);
+   writer.writeBit(false);
+
+   // Recipients keep the mirror of an entity once it was added, even without
+   // components, until it is deleted.
+   mKills.clear();
+   for (size_t i = 0; i < mDeleted.size(); ++i) {
+      size_t id = static_cast<size_t>(mDeleted[i]);
+      if (id < set.known.size() && set.known[id]) {
+         set.known[id] = false;
+         mKills.push_back(mDeleted[i]);
+      }
+   }
+   writer.writeVarint(mKills.size());
+   int previous = -1;
+   for (size_t i = 0; i < mKills.size(); ++i) {
+      writer.writeVarint(mKills[i] - previous - 1);
+      previous = mKills[i];
+   }
+
+   size_t sections = 0;
+   for (ComponentType t = 0; t < 64; ++t) {
+      if (set.types.test(t) && !mTypes[t].events.empty())
+         sections++;
+   }
+   writer.writeVarint(sections);
+
+   for (ComponentType t = 0; t < 64; ++t) {
+      if (!set.types.test(t) || mTypes[t].events.empty())
+         continue;
+      const std::vector<Event> &events = mTypes[t].events;
+      const std::vector<ReplicationSchema::Field> &fields = mSchema.getType(t)->fields;
+      const int64_t *sent = mTypes[t].sent.data();
+
+      writer.writeVarint(t);
+      writer.writeVarint(events.size());
+
+      previous = -1;
+      for (size_t i = 0; i < events.size(); ++i) {
+         const Event &event = events[i];
+         writer.writeVarint(event.id - previous - 1);
+         previous = event.id;
+         writer.writeBits(event.op, 2);
+         if (event.op == opAdd) {
+            for (size_t f = 0; f < fields.size(); ++f) {
+               writer.writeSigned(sent[event.id * fields.size() + f]);
+            }
+            if (static_cast<size_t>(event.id) >= set.known.size())
+               set.known.resize(event.id + 1, false);
+            set.known[event.id] = true;
+         }
+         else if (event.op == opUpdate) {
+            writer.writeBits(event.mask, static_cast<unsigned>(fields.size()));
+            size_t d = event.deltas;
+            for (size_t f = 0; f < fields.size(); ++f) {
+               if (event.mask & (uint64_t(1) << f))
+                  writer.writeSigned(mDeltas[d++]);
+            }
+         }
+      }
+   }
+   writer.flush();
+   set.frame = buffer;
+}
+
+std::shared_ptr<const ReplicationEncoder::Buffer> ReplicationEncoder::encodeKeyframe(int index)
+{
+   InterestSet &set = mSets[index];
+   std::shared_ptr<Buffer> buffer = std::make_shared<Buffer>();
+   BitWriter writer(buffer.get());
+   writer.writeVarint(mFrameCount);
+   writer.writeBit(true);
+   writer.writeVarint(0);
+
+   size_t sections = 0;
+   for (ComponentType t = 0; t < 64; ++t) {
+      if (set.types.test(t))
+         sections++;
+   }
+   writer.writeVarint(sections);
+
+   for (ComponentType t = 0; t < 64; ++t) {
+      if (!set.types.test(t))
+         continue;
+      const TypeState &state = mTypes[t];
+      const size_t fields = mSchema.getType(t)->fields.size();
+      writer.writeVarint(t);
+      writer.writeVarint(std::count(state.present.begin(), state.present.end(), true));
+
+      if (state.present.size() > set.known.size())
+         set.known.resize(state.present.size(), false);
+
+      int previous = -1;
+      for (size_t id = 0; id < state.present.size(); ++id) {
+         if (!state.present[id])
+            continue;
+         set.known[id] = true;
+         writer.writeVarint(id - previous - 1);
+         previous = static_cast<int>(id);
+         writer.writeBits(opAdd, 2);
+         for (size_t f = 0; f < fields; ++f) {
+            writer.writeSigned(state.sent[id * fields + f]);
+         }
+      }
+   }
+   writer.flush();
+   return buffer;
+}
+
+ReplicationDecoder::ReplicationDecoder(World *mirror, const ReplicationSchema &schema, size_t maxEntities): mWorld(mirror), mSchema(schema), mFrameCount(0),
+   mMaxEntities(maxEntities < static_cast<size_t>(INT32_MAX) ? maxEntities : static_cast<size_t>(INT32_MAX))
+{
+}
+
+void ReplicationDecoder::touch(int id, uint8_t flag)
+{
+   if (static_cast<size_t>(id) >= mTouched.size())
+      mTouched.resize(id + 1, 0);
+   if (mTouched[id] == 0)
+      mTouchedIds.push_back(id);
+   mTouched[id] |= flag;
+}
+
+void ReplicationDecoder::clear()
+{
+   for (size_t id = 0; id < mEntities.size(); ++id) {
+      if (mEntities[id] != nullptr)
+         mEntities[id]->deleteFromWorld();
+   }
+   mEntities.clear();
+   for (int t = 0; t < 64; ++t) {
+      mValues[t].clear();
+   }
+}
+
+bool ReplicationDecoder::applySection(BitReader &reader, ComponentType type)
+{
+   const ReplicationSchema::Type *schema = mSchema.getType(type);
+   if (schema == nullptr)
+      return false;
+   const size_t fields = schema->fields.size();
+   std::vector<int64_t> &values = mValues[type];
+
+   uint64_t entries = reader.readVarint();
+   int64_t id = -1;
+   for (uint64_t i = 0; i < entries && !reader.hasOverflowed(); ++i) {
+      id += static_cast<int64_t>(reader.readVarint()) + 1;
+      if (id < 0 || static_cast<uint64_t>(id) >= mMaxEntities)
+         return false;
+      int op = static_cast<int>(reader.readBits(2));
+
+      if (static_cast<size_t>(id) >= mEntities.size())
+         mEntities.resize(id + 1, nullptr);
+      if (values.size() < (id + 1) * fields)
+         values.resize((id + 1) * fields, 0);
+      int64_t *current = &values[id * fields];
+      Entity *e = mEntities[id];
+
+      if (op == 1) {
+         for (size_t f = 0; f < fields; ++f) {
+            current[f] = reader.readSigned();
+         }
+         if (e == nullptr) {
+            e = mWorld->createEntity();
+            mEntities[id] = e;
+            touch(static_cast<int>(id), 1);
+         }
+         Component *component = e->getComponent(type);
+         if (component == nullptr) {
+            component = schema->codec.create();
+            e->addComponent(component);
+            touch(static_cast<int>(id), 2);
+         }
+         for (size_t f = 0; f < fields; ++f) {
+            ReplicationSchema::write(component, schema->fields[f], current[f]);
+         }
+      }
+      else if (op == 0) {
+         uint64_t mask = reader.readBits(static_cast<unsigned>(fields));
+         Component *component = e != nullptr ? e->getComponent(type) : nullptr;
+         if (component == nullptr)
+            return false;
+         for (size_t f = 0; f < fields; ++f) {
+            if (mask & (uint64_t(1) << f)) {
+               current[f] += reader.readSigned();
+               ReplicationSchema::write(component, schema->fields[f], current[f]);
+            }
+         }
+      }
+      else if (op == 2) {
+         if (e == nullptr)
+            return false;
+         e->removeComponent(type);
+         touch(static_cast<int>(id), 2);
+      }
+      else {
+         return false;
+      }
+   }
+   return !reader.hasOverflowed();
+}
+
+bool ReplicationDecoder::apply(const uint8_t *data, size_t size)
+{
+   ARTEMIS_ZONE("ReplicationDecoder::apply");
+   BitReader reader(data, size);
+   uint64_t frame = reader.readVarint();
+   bool keyframe = reader.readBit();
+   if (reader.hasOverflowed() || (!keyframe && frame != mFrameCount + 1))
+      return false;
+   if (keyframe)
+      clear();
+
+   // A mirror made from a keyframe lacks the entities left without components.
+   bool ok = true;
+   uint64_t kills = reader.readVarint();
+   int64_t id = -1;
+   for (uint64_t i = 0; i < kills && !reader.hasOverflowed(); ++i) {
+      id += static_cast<int64_t>(reader.readVarint()) + 1;
+      Entity *e = id >= 0 && static_cast<uint64_t>(id) < mEntities.size() ? mEntities[id] : nullptr;
+      if (e != nullptr) {
+         e->deleteFromWorld();
+         mEntities[id] = nullptr;
+      }
+   }
+
+   uint64_t sections = reader.readVarint();
+   for (uint64_t i = 0; i < sections && ok && !reader.hasOverflowed(); ++i) {
+      uint64_t type = reader.readVarint();
+      ok = type < 64 && applySection(reader, static_cast<ComponentType>(type));
+   }
+   ok = ok && !reader.hasOverflowed();
+
+   for (size_t i = 0; i < mTouchedIds.size(); ++i) {
+      int touched = mTouchedIds[i];
+      Entity *e = static_cast<size_t>(touched) < mEntities.size() ? mEntities[touched] : nullptr;
+      if (e != nullptr) {
+         if (mTouched[touched] & 1)
+            e->addToWorld();
+         else
+            e->changedInWorld();
+      }
+      mTouched[touched] = 0;
+   }
+   mTouchedIds.clear();
+
+   if (ok)
+      mFrameCount = frame;
+   return ok;
+}
+
+}
@@ -0,0 +1,261 @@
+#ifndef Artemis_Replication_h__
+#define Artemis_Replication_h__
+
+#include "artemis/ComponentCodec.h"
+#include "artemis/ComponentType.h"
+#include "artemis/utils/ChangeTracker.h"
+#include <bitset>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace artemis
+{
+class Entity;
+class World;
+class BitWriter;
+class BitReader;
+
+/**
+ * Describes which component types are replicated and how their fields go on the
+ * wire. Encoder and decoder sides must describe the same types and fields in the
+ * same order.
+ */
+class ReplicationSchema
+{
+public:
+   static const size_t MAX_FIELDS = 64;
+
+   enum FieldKinds {
+      fkFloat = 0, // quantized to a multiple of the precision
+      fkInt,
+      fkWord       // up to 4 raw bytes
+   };
+
+   struct Field
+   {
+      size_t offset; // from the start of the component object
+      size_t size;
+      int kind;
+      float precision;
+   };
+
+   struct Type
+   {
+      ComponentCodec codec;
+      std::vector<Field> fields;
+      bool described; // fields were added, the default raw words are replaced
+   };
+
+private:
+   Type mTypes[64];
+   std::bitset<64> mRegistered;
+
+   template<typename T, typename F>
+   static size_t offsetOf(F T::*member)
+   {
+      T probe;
+      return reinterpret_cast<const char *>(&(probe.*member)) - reinterpret_cast<const char *>(static_cast<const Component *>(&probe));
+   }
+
+   void addField(ComponentType type, size_t offset, size_t size, int kind, float precision);
+
+public:
+   /**
+    * Replicates a component type. Until fields are added its data is sent as
+    * 32-bit words, only the words that changed.
+    */
+   template<typename T, ComponentType cType>
+   void addComponent()
+   {
+      setType(cType, ComponentCodec::of<T>());
+   }
+
+   /**
+    * Sends a float member quantized to a multiple of the precision.
+    */
+   template<typename T>
+   void addFloat(ComponentType type, float T::*member, float precision)
+   {
+      addField(type, offsetOf(member), sizeof(float), fkFloat, precision);
+   }
+
+   /**
+    * Sends an integer member as a variable-length delta.
+    */
+   template<typename T>
+   void addInt(ComponentType type, int32_t T::*member)
+   {
+      addField(type, offsetOf(member), sizeof(int32_t), fkInt, 0.f);
+   }
+
+   void setType(ComponentType type, const ComponentCodec &codec);
+
+   const Type * getType(ComponentType type) const
+   {
+      return type < 64 && mRegistered.test(type) ? &mTypes[type] : nullptr;
+   }
+
+   const std::bitset<64> & getTypes() const { return mRegistered; }
+
+   /**
+    * @return the value of a field as sent on the wire.
+    */
+   static int64_t read(const Component *component, const Field &field);
+
+   /**
+    * Sets a field from its wire value.
+    */
+   static void write(Component *component, const Field &field, int64_t value);
+};
+
+/**
+ * Turns the changes of replicated components since the previous call into one
+ * compact frame per interest set. Call encode() after World.process(); it looks at
+ * the components a ChangeTracker saw change, so they must be written through
+ * ComponentMapper.edit() or Entity.editComponent(), compares them against what was
+ * sent last, and writes per type the entities whose components were added, removed
+ * or changed, with a bit per changed field and quantized, variable-length deltas.
+ * The types of the schema are tracked from when the encoder is made.
+ *
+ * An interest set is a set of component types. Every recipient with the same
+ * interest set is handed the same immutable buffer. Frames are deltas and must be
+ * applied in order; a recipient that joins or misses a frame gets a keyframe.
+ */
+class ReplicationEncoder
+{
+public:
+   typedef std::vector<uint8_t> Buffer;
+
+private:
+   enum Ops {
+      opUpdate = 0,
+      opAdd,
+      opRemove
+   };
+
+   struct Event
+   {
+      int id;
+      int op;
+      uint64_t mask;
+      size_t deltas; // first delta in mDeltas for updates
+   };
+
+   struct TypeState
+   {
+      std::vector<int64_t> sent;  // values last sent, fields per entity id
+      std::vector<bool> present;
+      std::vector<Event> events;
+   };
+
+   struct InterestSet
+   {
+      std::bitset<64> types;
+      std::shared_ptr<const Buffer> frame;
+      std::vector<bool> known; // entities the recipients have a mirror of, by id
+   };
+
+   World *mWorld;
+   const ReplicationSchema &mSchema;
+   TypeState mTypes[64];
+   std::vector<int64_t> mDeltas;
+   std::vector<InterestSet> mSets;
+   std::vector<int> mDeleted;
+   std::vector<int> mKills;
+   uint64_t mFrameCount;
+   ChangeTracker mChanges;
+
+   void scan(ComponentType type);
+   void writeFrame(InterestSet &set);
+
+   ReplicationEncoder(const ReplicationEncoder &) = delete;
+   ReplicationEncoder & operator=(const ReplicationEncoder &) = delete;
+
+public:
+   ReplicationEncoder(World *world, const ReplicationSchema &schema);
+
+   /**
+    * @param types component types the recipients of this set receive.
+    * @return the index of the interest set.
+    */
+   int addInterestSet(const std::bitset<64> &types);
+
+   /**
+    * Encodes the changes since the previous call for every interest set.
+    */
+   void encode();
+
+   /**
+    * @return the frame of an interest set encoded by the last encode(), shared by its recipients.
+    */
+   std::shared_ptr<const Buffer> getFrame(int set) const { return mSets[set].frame; }
+
+   /**
+    * Encodes the whole replicated state as of the last encode() for an interest set,
+    * for recipients that join late or lost frames.
+    */
+   std::shared_ptr<const Buffer> encodeKeyframe(int set);
+
+   /**
+    * @return number of frames encoded.
+    */
+   uint64_t getFrameCount() const { return mFrameCount; }
+};
+
+/**
+ * Applies frames of a ReplicationEncoder to a mirror world. Mirror entities are
+ * created, changed and deleted through the usual Entity calls, so systems of the
+ * mirror world see them on its next World.process().
+ */
+class ReplicationDecoder
+{
+private:
+   World *mWorld;
+   const ReplicationSchema &mSchema;
+   std::vector<Entity *> mEntities; // mirror entity per remote id
+   std::vector<int64_t> mValues[64];
+   std::vector<uint8_t> mTouched;   // per remote id: 1 created, 2 changed
+   std::vector<int> mTouchedIds;
+   uint64_t mFrameCount;
+   size_t mMaxEntities;
+
+   bool applySection(BitReader &reader, ComponentType type);
+   void touch(int id, uint8_t flag);
+   void clear();
+
+   ReplicationDecoder(const ReplicationDecoder &) = delete;
+   ReplicationDecoder & operator=(const ReplicationDecoder &) = delete;
+
+public:
+   /**
+    * @param maxEntities bound of the remote ids accepted; a frame with a larger id is
+    *        rejected as malformed rather than growing the mirror tables to it.
+    */
+   ReplicationDecoder(World *mirror, const ReplicationSchema &schema, size_t maxEntities = 1 << 20);
+
+   /**
+    * Applies a frame. A keyframe replaces all mirror entities.
+    *
+    * @return false if the frame is malformed or does not follow the last one applied,
+    *         the mirror then needs a keyframe.
+    */
+   bool apply(const uint8_t *data, size_t size);
+   bool apply(const ReplicationEncoder::Buffer &frame) { return apply(frame.data(), frame.size()); }
+
+   /**
+    * @return the mirror of a remote entity, null if it has none.
+    */
+   Entity * getEntity(int remoteId) const
+   {
+      return remoteId >= 0 && static_cast<size_t>(remoteId) < mEntities.size() ? mEntities[remoteId] : nullptr;
+   }
+
+   /**
+    * @return number of frames applied, counting the frames a keyframe stands for.
+    */
+   uint64_t getFrameCount() const { return mFrameCount; }
+};
+
+}
+#endif // Artemis_Replication_h__
@@ -0,0 +1,188 @@
+#include "artemis/utils/StreamingLoader.h"
+#include "artemis/World.h"
+#include "artemis/utils/Instrumentation.h"
+#include <cstdio>
+#include <cstring>
+
+namespace artemis
+{
+
+StreamingLoader::StreamingLoader(World *world, size_t budget, size_t buffers): mWorld(world), mBudget(budget),
+   mFailedFiles(0), mStagedEntities(0), mReading(false), mStop(false), mCurrent(nullptr), mCommitted(0)
+{
+   if (buffers == 0)
+      buffers = 1;
+   for (size_t i = 0; i < buffers; ++i) {
+      mBuffers.push_back(new Staging());
+      mFree.push_back(mBuffers.back());
+   }
+   mThread = std::thread(&StreamingLoader::run, this);
+}
+
+StreamingLoader::~StreamingLoader()
+{
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mStop = true;
+   }
+   mWake.notify_all();
+   mThread.join();
+   for (size_t i = 0; i < mBuffers.size(); ++i) {
+      delete mBuffers[i];
+   }
+}
+
+void StreamingLoader::load(const std::string &path)
+{
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mFiles.push_back(path);
+   }
+   mWake.notify_all();
+}
+
+void StreamingLoader::run()
+{
+   std::unique_lock<std::mutex> lock(mMutex);
+   for (;;) {
+      mWake.wait(lock, [this] { return mStop || !mFiles.empty(); });
+      if (mStop)
+         return;
+      std::string path = mFiles.front();
+      mFiles.pop_front();
+      mReading = true;
+      lock.unlock();
+      bool ok = readFile(path);
+      lock.lock();
+      mReading = false;
+      if (!ok)
+         mFailedFiles++;
+   }
+}
+
+bool StreamingLoader::readFile(const std::string &path)
+{
+   std::FILE *file = std::fopen(path.c_str(), "rb");
+   if (file == nullptr)
+      return false;
+
+   EntityFile::Header header;
+   char raw[sizeof(EntityFile::Header)];
+   bool ok = std::fread(raw, sizeof(raw), 1, file) == 1 && EntityFile::readHeader(raw, sizeof(raw), header);
+
+   // The chunk sizes come from the file, so they are checked against what is left
+   // of it before a buffer of that size is made.
+   long fileSize = -1;
+   if (ok && std::fseek(file, 0, SEEK_END) == 0) {
+      fileSize = std::ftell(file);
+      ok = std::fseek(file, sizeof(raw), SEEK_SET) == 0;
+   }
+   ok = ok && fileSize >= 0;
+
+   for (uint32_t i = 0; ok && i < header.chunkCount; ++i) {
+      EntityFile::ChunkHeader chunk;
+      if (std::fread(&chunk, sizeof(chunk), 1, file) != 1) {
+         ok = false;
+         break;
+      }
+      long at = std::ftell(file);
+      if (at < 0 || at > fileSize || chunk.size > static_cast<uint64_t>(fileSize - at)) {
+         ok = false;
+         break;
+      }
+
+      Staging *staging;
+      {
+         std::unique_lock<std::mutex> lock(mMutex);
+         mWake.wait(lock, [this] { return mStop || !mFree.empty(); });
+         if (mStop)
+            break;
+         staging = mFree.back();
+         mFree.pop_back();
+      }
+
+      ARTEMIS_ZONE("StreamingLoader::readChunk");
+      staging->data.resize(sizeof(chunk) + chunk.size);
+      std::memcpy(&staging->data[0], &chunk, sizeof(chunk));
+      ok = chunk.size == 0 || std::fread(&staging->data[sizeof(chunk)], chunk.size, 1, file) == 1;
+
+      std::lock_guard<std::mutex> lock(mMutex);
+      if (ok) {
+         mReady.push_back(staging);
+         mStagedEntities += chunk.entityCount;
+      }
+      else {
+         mFree.push_back(staging);
+      }
+   }
+   std::fclose(file);
+   return ok;
+}
+
+void StreamingLoader::release(Staging *staging)
+{
+   {
+      std::lock_guard<std::mutex> lock(mMutex);
+      mFree.push_back(staging);
+   }
+   mWake.notify_all();
+}
+
+size_t StreamingLoader::commit()
+{
+   size_t committed = 0;
+   while (committed < mBudget) {
+      if (mCurrent == nullptr) {
+         {
+            std::lock_guard<std::mutex> lock(mMutex);
+            if (mReady.empty())
+               break;
+            mCurrent = mReady.front();
+            mReady.pop_front();
+         }
+         if (!mChunk.parse(mWorld, mCurrent->data.data(), mCurrent->data.size())) {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mStagedEntities -= reinterpret_cast<const EntityFile::ChunkHeader *>(mCurrent->data.data())->entityCount;
+            mFailedFiles++;
+            mFree.push_back(mCurrent);
+            mCurrent = nullptr;
+            mWake.notify_all();
+            continue;
+         }
+      }
+
+      ARTEMIS_ZONE("StreamingLoader::commit");
+      size_t n = mChunk.commit(mWorld, mBudget - committed);
+      committed += n;
+      {
+         std::lock_guard<std::mutex> lock(mMutex);
+         mStagedEntities -= n;
+      }
+      if (mChunk.isDone()) {
+         release(mCurrent);
+         mCurrent = nullptr;
+      }
+   }
+   mCommitted += committed;
+   return committed;
+}
+
+bool StreamingLoader::isIdle()
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   return mFiles.empty() && !mReading && mReady.empty() && mCurrent == nullptr;
+}
+
+size_t StreamingLoader::getPendingEntities()
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   return mStagedEntities;
+}
+
+size_t StreamingLoader::getFailedFiles()
+{
+   std::lock_guard<std::mutex> lock(mMutex);
+   return mFailedFiles;
+}
+
+}
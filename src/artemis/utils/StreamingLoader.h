@@ -0,0 +1,104 @@
+#ifndef Artemis_StreamingLoader_h__
+#define Artemis_StreamingLoader_h__
+
+#include "artemis/utils/EntityFile.h"
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace artemis
+{
+class World;
+
+/**
+ * Loads entity files, see EntityFile, without stalling frames. A background thread
+ * reads chunks into a fixed number of staging buffers; World.process() commits up to
+ * a budget of entities per frame from them, before the added entities are checked.
+ * Enable it with World.enableStreamingLoader().
+ */
+class StreamingLoader
+{
+private:
+   struct Staging
+   {
+      std::vector<char> data;
+   };
+
+   World *mWorld;
+   size_t mBudget;
+
+   std::thread mThread;
+   std::mutex mMutex;
+   std::condition_variable mWake;      // for the reader: files or free buffers
+   std::deque<std::string> mFiles;
+   std::vector<Staging *> mFree;
+   std::deque<Staging *> mReady;
+   std::vector<Staging *> mBuffers;
+   size_t mFailedFiles;
+   size_t mStagedEntities;
+   bool mReading;
+   bool mStop;
+
+   // Used by the simulation thread only.
+   Staging *mCurrent;
+   EntityFile::Chunk mChunk;
+   size_t mCommitted;
+
+   void run();
+   bool readFile(const std::string &path);
+   void release(Staging *staging);
+
+   StreamingLoader(const StreamingLoader &) = delete;
+   StreamingLoader & operator=(const StreamingLoader &) = delete;
+
+public:
+   /**
+    * @param budget entities committed per frame at most.
+    * @param buffers staging buffers, i.e. chunks read ahead.
+    */
+   StreamingLoader(World *world, size_t budget, size_t buffers = 4);
+   ~StreamingLoader();
+
+   /**
+    * Queues a file, loaded after the ones queued before it.
+    */
+   void load(const std::string &path);
+
+   /**
+    * Commits staged entities, up to the budget. Called by World.process().
+    *
+    * @return number of entities committed.
+    */
+   size_t commit();
+
+   void setBudget(size_t budget) { mBudget = budget; }
+   size_t getBudget() const { return mBudget; }
+
+   /**
+    * @return true when every queued file is read and committed.
+    */
+   bool isIdle();
+
+   /**
+    * @return entities of the files read so far that are not committed yet.
+    */
+   size_t getPendingEntities();
+
+   /**
+    * @return entities committed since the loader was created.
+    */
+   size_t getCommittedEntities() const { return mCommitted; }
+
+   /**
+    * @return files that could not be read, stopping where reading failed, plus
+    *         malformed chunks, which are skipped.
+    */
+   size_t getFailedFiles();
+};
+
+}
+#endif // Artemis_StreamingLoader_h__
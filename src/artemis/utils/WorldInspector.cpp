@@ -0,0 +1,378 @@
+#include "artemis/utils/WorldInspector.h"
+#include "artemis/World.h"
+#include "artemis/EntityManager.h"
+#include "artemis/EntitySystem.h"
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#define ARTEMIS_HAS_UNIX_SOCKETS 1
+#endif
+
+namespace artemis
+{
+
+WorldInspector::WorldInspector(World *world, const std::string &path): mWorld(world), mPath(path), mSocket(-1),
+   mRunning(false), mRequested(false), mSequence(0), mFrame(0)
+{
+   std::memset(static_cast<void *>(&mSnapshot), 0, sizeof(Snapshot));
+}
+
+WorldInspector::~WorldInspector()
+{
+   stop();
+}
+
+void WorldInspector::update()
+{
+   uint64_t frame = mFrame.fetch_add(1, std::memory_order_relaxed) + 1;
+   if (!mRequested.load(std::memory_order_acquire))
+      return;
+   mRequested.store(false, std::memory_order_relaxed);
+
+   Snapshot snapshot;
+   std::memset(static_cast<void *>(&snapshot), 0, sizeof(Snapshot));
+   snapshot.frame = frame;
+
+   EntityManager *em = mWorld->getEntityManager();
+   snapshot.activeEntities = em->getActiveEntityCount();
+   snapshot.totalCreated = em->getTotalCreated();
+   snapshot.totalAdded = em->getTotalAdded();
+   snapshot.totalDeleted = em->getTotalDeleted();
+
+   FrameProfiler *profiler = mWorld->getProfiler();
+   snapshot.profiled = profiler != nullptr;
+   if (profiler != nullptr) {
+      snapshot.frameTimes = profiler->getFramePercentiles();
+   }
+
+   Bag<EntitySystem *> &systems = mWorld->getSystems();
+   for (size_t i = 0; i < systems.size() && i < MAX_TYPES; ++i) {
+      EntitySystem *system = systems.get(i);
+      if (system == nullptr)
+         continue;
+      snapshot.systems[i] = true;
+      snapshot.systemActives[i] = system->getActives()->size();
+      if (profiler != nullptr) {
+         snapshot.systemTimes[i] = profiler->getSystemPercentiles(i);
+      }
+   }
+
+   snapshot.memory = mWorld->memoryReport();
+
+   ChurnCounters *churn = mWorld->getChurnCounters();
+   snapshot.churn = churn != nullptr;
+   if (churn != nullptr) {
+      snapshot.churnFrame = churn->getLastFrame();
+   }
+
+   uint64_t sequence = mSequence.load(std::memory_order_relaxed);
+   mSequence.store(sequence + 1, std::memory_order_relaxed);
+   std::atomic_thread_fence(std::memory_order_release);
+   std::memcpy(static_cast<void *>(&mSnapshot), &snapshot, sizeof(Snapshot));
+   mSequence.store(sequence + 2, std::memory_order_release);
+}
+
+bool WorldInspector::readSnapshot(Snapshot &out)
+{
+   uint64_t before = mSequence.load(std::memory_order_acquire);
+   mRequested.store(true, std::memory_order_release);
+
+   // give the simulation a moment to publish, serve the previous snapshot otherwise
+   std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+   while (mSequence.load(std::memory_order_acquire) <= before + 1 && std::chrono::steady_clock::now() < deadline) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+   }
+
+   for (;;) {
+      uint64_t sequence = mSequence.load(std::memory_order_acquire);
+      if (sequence == 0)
+         return false;
+      if (sequence & 1)
+         continue;
+      std::memcpy(static_cast<void *>(&out), &mSnapshot, sizeof(Snapshot));
+      std::atomic_thread_fence(std::memory_order_acquire);
+      if (mSequence.load(std::memory_order_relaxed) == sequence)
+         return true;
+   }
+}
+
+namespace
+{
+
+void writeUsage(std::ostream &out, const MemoryUsage &usage)
+{
+   out << "{\"used\":" << usage.used << ",\"reserved\":" << usage.reserved << '}';
+}
+
+void writePercentiles(std::ostream &out, const FrameProfiler::Percentiles &p)
+{
+   out << "{\"samples\":" << p.samples << ",\"p50_ns\":" << p.p50 << ",\"p95_ns\":" << p.p95
+       << ",\"p99_ns\":" << p.p99 << ",\"max_ns\":" << p.max << '}';
+}
+
+void writeCounts(std::ostream &out, const WorldInspector::Snapshot &s)
+{
+   out << "\"counts\":{\"active\":" << s.activeEntities << ",\"created\":" << s.totalCreated
+       << ",\"added\":" << s.totalAdded << ",\"deleted\":" << s.totalDeleted << ",\"components\":{";
+   bool first = true;
+   for (size_t i = 0; i < MemoryReport::MAX_TYPES; ++i) {
+      if (s.memory.componentStorage[i].reserved == 0)
+         continue;
+      out << (first ? "" : ",") << '"' << i << "\":" << s.memory.componentStorage[i].used / sizeof(Component *);
+      first = false;
+   }
+   out << "}}";
+}
+
+void writeSystems(std::ostream &out, const WorldInspector::Snapshot &s)
+{
+   out << "\"systems\":{";
+   if (s.profiled) {
+      out << "\"frame\":";
+      writePercentiles(out, s.frameTimes);
+      out << ',';
+   }
+   out << "\"by_type\":{";
+   bool first = true;
+   for (size_t i = 0; i < WorldInspector::MAX_TYPES; ++i) {
+      if (!s.systems[i])
+         continue;
+      out << (first ? "" : ",") << '"' << i << "\":{\"actives\":" << s.systemActives[i];
+      if (s.profiled) {
+         out << ",\"time\":";
+         writePercentiles(out, s.systemTimes[i]);
+      }
+      out << '}';
+      first = false;
+   }
+   out << "}}";
+}
+
+void writeMemory(std::ostream &out, const WorldInspector::Snapshot &s)
+{
+   const MemoryReport &m = s.memory;
+   out << "\"memory\":{\"total\":";
+   writeUsage(out, m.getTotal());
+   out << ",\"entities\":";
+   writeUsage(out, m.entities);
+   out << ",\"identifier_pool\":";
+   writeUsage(out, m.identifierPool);
+   out << ",\"world\":";
+   writeUsage(out, m.world);
+
+   const char *names[] = { "component_storage", "component_objects", "systems", "managers" };
+   const MemoryUsage *tables[] = { m.componentStorage, m.componentObjects, m.systems, m.managers };
+   for (int t = 0; t < 4; ++t) {
+      out << ",\"" << names[t] << "\":{";
+      bool first = true;
+      for (size_t i = 0; i < MemoryReport::MAX_TYPES; ++i) {
+         if (tables[t][i].reserved == 0)
+            continue;
+         out << (first ? "" : ",") << '"' << i << "\":";
+         writeUsage(out, tables[t][i]);
+         first = false;
+      }
+      out << '}';
+   }
+   out << '}';
+}
+
+void writeChurn(std::ostream &out, const WorldInspector::Snapshot &s)
+{
+   out << "\"churn\":";
+   if (!s.churn) {
+      out << "null";
+      return;
+   }
+   const ChurnCounters::Frame &f = s.churnFrame;
+   out << "{\"checks\":" << f.checks << ",\"bag_growths\":" << f.bagGrowths;
+   const char *names[] = { "component_adds", "component_removes", "system_inserts", "system_removes" };
+   const uint64_t *tables[] = { f.componentAdds, f.componentRemoves, f.systemInserts, f.systemRemoves };
+   for (int t = 0; t < 4; ++t) {
+      out << ",\"" << names[t] << "\":{";
+      bool first = true;
+      for (size_t i = 0; i < ChurnCounters::MAX_TYPES; ++i) {
+         if (tables[t][i] == 0)
+            continue;
+         out << (first ? "" : ",") << '"' << i << "\":" << tables[t][i];
+         first = false;
+      }
+      out << '}';
+   }
+   out << '}';
+}
+
+}
+
+std::string WorldInspector::answer(const std::string &command)
+{
+   bool all = command == "all";
+   if (!all && command != "counts" && command != "systems" && command != "memory" && command != "churn") {
+      return "{\"error\":\"unknown command, expected counts, systems, memory, churn or all\"}";
+   }
+
+   Snapshot *snapshot = new Snapshot();
+   if (!readSnapshot(*snapshot)) {
+      delete snapshot;
+      return "{\"error\":\"the world has not processed a frame since the inspector started\"}";
+   }
+
+   std::ostringstream out;
+   out << "{\"frame\":" << snapshot->frame << ",\"stale\":" << (snapshot->frame < mFrame.load(std::memory_order_relaxed) ? "true" : "false");
+   if (all || command == "counts") {
+      out << ',';
+      writeCounts(out, *snapshot);
+   }
+   if (all || command == "systems") {
+      out << ',';
+      writeSystems(out, *snapshot);
+   }
+   if (all || command == "memory") {
+      out << ',';
+      writeMemory(out, *snapshot);
+   }
+   if (all || command == "churn") {
+      out << ',';
+      writeChurn(out, *snapshot);
+   }
+   out << '}';
+   delete snapshot;
+   return out.str();
+}
+
+#ifdef ARTEMIS_HAS_UNIX_SOCKETS
+
+namespace
+{
+
+/*
+ * Removes a socket left at a path, never a file of another kind.
+ * @return false if something other than a socket is there.
+ */
+bool removeSocket(const std::string &path)
+{
+   struct stat status;
+   if (lstat(path.c_str(), &status) != 0)
+      return true;
+   if (!S_ISSOCK(status.st_mode))
+      return false;
+   unlink(path.c_str());
+   return true;
+}
+
+}
+
+bool WorldInspector::start()
+{
+   if (mRunning.load())
+      return true;
+
+   sockaddr_un address;
+   std::memset(&address, 0, sizeof(address));
+   address.sun_family = AF_UNIX;
+   if (mPath.size() >= sizeof(address.sun_path))
+      return false;
+   std::strcpy(address.sun_path, mPath.c_str());
+
+   if (!removeSocket(mPath))
+      return false;
+   mSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+   if (mSocket < 0)
+      return false;
+   if (bind(mSocket, reinterpret_cast<sockaddr *>(&address), sizeof(address)) != 0 || listen(mSocket, 4) != 0) {
+      close(mSocket);
+      mSocket = -1;
+      return false;
+   }
+
+   mRunning.store(true);
+   mThread = std::thread(&WorldInspector::run, this);
+   return true;
+}
+
+void WorldInspector::stop()
+{
+   if (!mRunning.exchange(false))
+      return;
+   mThread.join();
+   close(mSocket);
+   mSocket = -1;
+   removeSocket(mPath);
+}
+
+void WorldInspector::run()
+{
+   while (mRunning.load()) {
+      pollfd listener = { mSocket, POLLIN, 0 };
+      if (poll(&listener, 1, 100) <= 0)
+         continue;
+      int client = accept(mSocket, nullptr, nullptr);
+      if (client >= 0) {
+         serve(client);
+         close(client);
+      }
+   }
+}
+
+void WorldInspector::serve(int client)
+{
+   std::string pending;
+   char buffer[256];
+   while (mRunning.load()) {
+      pollfd connection = { client, POLLIN, 0 };
+      if (poll(&connection, 1, 100) <= 0)
+         continue;
+      ssize_t n = read(client, buffer, sizeof(buffer));
+      if (n <= 0)
+         return;
+      pending.append(buffer, n);
+
+      size_t end;
+      while ((end = pending.find('\n')) != std::string::npos) {
+         std::string command = pending.substr(0, end);
+         pending.erase(0, end + 1);
+         if (!command.empty() && command[command.size() - 1] == '\r')
+            command.erase(command.size() - 1);
+         if (command.empty())
+            continue;
+
+         std::string response = answer(command) + "\n";
+         for (size_t sent = 0; sent < response.size(); ) {
+            ssize_t w = write(client, response.data() + sent, response.size() - sent);
+            if (w <= 0)
+               return;
+            sent += w;
+         }
+      }
+   }
+}
+
+#else
+
+bool WorldInspector::start()
+{
+   return false;
+}
+
+void WorldInspector::stop()
+{
+}
+
+void WorldInspector::run()
+{
+}
+
+void WorldInspector::serve(int)
+{
+}
+
+#endif // ARTEMIS_HAS_UNIX_SOCKETS
+
+}
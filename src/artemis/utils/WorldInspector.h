@@ -0,0 +1,102 @@
+#ifndef Artemis_WorldInspector_h__
+#define Artemis_WorldInspector_h__
+
+#include "artemis/utils/ChurnCounters.h"
+#include "artemis/utils/FrameProfiler.h"
+#include "artemis/utils/MemoryReport.h"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+namespace artemis
+{
+class World;
+
+/**
+ * Answers queries about a running world on a local Unix domain socket, from a
+ * thread of its own. Clients send one command per line and get one line of JSON
+ * back per command:
+ *
+ *   counts   entity counts and components per type
+ *   systems  actives per system, and timings if the world's profiler is enabled
+ *   memory   the world's memory report
+ *   churn    the last frame of the churn counters if they are enabled
+ *   all      everything above
+ *
+ * The simulation thread never waits on the inspector. When a query comes in, the
+ * next World.process() takes a snapshot and publishes it under a sequence counter;
+ * the inspector copies it out and retries if it was being rewritten. If the world
+ * is not processing frames, the last snapshot is served, marked stale.
+ *
+ * Start it with World.startInspector(). Only available on Unix systems.
+ */
+class WorldInspector
+{
+public:
+   static const size_t MAX_TYPES = 64;
+
+   struct Snapshot
+   {
+      uint64_t frame;
+      int activeEntities;
+      long int totalCreated;
+      long int totalAdded;
+      long int totalDeleted;
+      bool systems[MAX_TYPES];
+      size_t systemActives[MAX_TYPES];
+      bool profiled;
+      FrameProfiler::Percentiles systemTimes[MAX_TYPES];
+      FrameProfiler::Percentiles frameTimes;
+      MemoryReport memory;
+      bool churn;
+      ChurnCounters::Frame churnFrame;
+   };
+
+private:
+   World *mWorld;
+   std::string mPath;
+   int mSocket;
+   std::thread mThread;
+   std::atomic<bool> mRunning;
+
+   // written by the simulation thread, read by the inspector thread
+   std::atomic<bool> mRequested;
+   std::atomic<uint64_t> mSequence;
+   Snapshot mSnapshot;
+   std::atomic<uint64_t> mFrame;
+
+   WorldInspector(const WorldInspector &) = delete;
+   WorldInspector & operator=(const WorldInspector &) = delete;
+
+   void run();
+   void serve(int client);
+   bool readSnapshot(Snapshot &out);
+   std::string answer(const std::string &command);
+
+public:
+   WorldInspector(World *world, const std::string &path);
+   ~WorldInspector();
+
+   /**
+    * Binds the socket, replacing a stale one at the same path, and starts the thread.
+    * @return false if the socket could not be bound, or the path is taken by a file
+    *         that is not a socket.
+    */
+   bool start();
+
+   /**
+    * Stops the thread and removes the socket.
+    */
+   void stop();
+
+   const std::string & getPath() const { return mPath; }
+
+   /**
+    * Called by World at the end of every World.process(), publishes a snapshot if one was requested.
+    */
+   void update();
+};
+
+}
+#endif // Artemis_WorldInspector_h__